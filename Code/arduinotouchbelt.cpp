@@ -1,14 +1,110 @@
-#include <PS2Mouse.h>
+#include <FlashStorage.h>
 
 // Define PS/2 pins
 #define MOUSE_DATA 5
 #define MOUSE_CLOCK 4
 
-PS2Mouse mouse(MOUSE_CLOCK, MOUSE_DATA, STREAM);
+// PS/2 host timing; every wait is bounded so a missing or resetting pad can't hang the loop
+const unsigned long PS2_REQUEST_TIMEOUT_US = 15000;  // Pad must start clocking a host byte within 15 ms
+const unsigned long PS2_BIT_TIMEOUT_US = 2000;       // Longest clock phase once a byte is on the wire
 
-// Function to read the next available byte (blocking)
+const unsigned long PAD_RESPONSE_TIMEOUT_MS = 25;  // Longest wait for a command response byte
+const unsigned long PAD_SELF_TEST_MS = 750;        // Self test after a reset command
+
+// Set when a pad read or write times out, cleared by whoever checks it
+bool padTimedOut = false;
+
+// Lines are open collector: release lets the pull-up raise them, hold drives them low
+void ps2Release(uint8_t pin) {
+  pinMode(pin, INPUT_PULLUP);
+}
+
+void ps2Hold(uint8_t pin) {
+  digitalWrite(pin, LOW);
+  pinMode(pin, OUTPUT);
+}
+
+// Function to wait for a line level, false on timeout
+bool ps2WaitLine(uint8_t pin, uint8_t level, unsigned long timeoutUs) {
+  unsigned long start = micros();
+  while (digitalRead(pin) != level) {
+    if (micros() - start >= timeoutUs) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Function to read the next byte from the pad, -1 if none arrives within timeoutMs
+int16_t padRead(unsigned long timeoutMs) {
+  ps2Release(MOUSE_CLOCK);
+  ps2Release(MOUSE_DATA);
+
+  // Start bit
+  bool ok = ps2WaitLine(MOUSE_CLOCK, LOW, timeoutMs * 1000UL) && ps2WaitLine(MOUSE_CLOCK, HIGH, PS2_BIT_TIMEOUT_US);
+
+  // 8 data bits (LSB first), parity and stop, each valid while the clock is low
+  uint8_t data = 0;
+  for (uint8_t i = 0; ok && (i < 10); i++) {
+    ok = ps2WaitLine(MOUSE_CLOCK, LOW, PS2_BIT_TIMEOUT_US);
+    if (ok && (i < 8) && digitalRead(MOUSE_DATA)) {
+      data |= 1 << i;
+    }
+    ok = ok && ps2WaitLine(MOUSE_CLOCK, HIGH, PS2_BIT_TIMEOUT_US);
+  }
+
+  // Inhibit the pad until the next read, it buffers its output meanwhile
+  ps2Hold(MOUSE_CLOCK);
+  return ok ? data : -1;
+}
+
+// Function to send one byte to the pad (its 0xFA is read separately), false on timeout
+bool ps2Write(uint8_t data) {
+  // Request to send: inhibit, pull data low as the start bit, release the clock
+  ps2Hold(MOUSE_CLOCK);
+  delayMicroseconds(120);
+  ps2Hold(MOUSE_DATA);
+  delayMicroseconds(10);
+  ps2Release(MOUSE_CLOCK);
+
+  // 8 data bits and odd parity, changed while the pad holds the clock low
+  uint8_t parity = 1;
+  bool ok = ps2WaitLine(MOUSE_CLOCK, LOW, PS2_REQUEST_TIMEOUT_US);
+  for (uint8_t i = 0; ok && (i < 9); i++) {
+    uint8_t bit = (i < 8) ? ((data >> i) & 0x01) : parity;
+    parity ^= bit;
+    if (bit) {
+      ps2Release(MOUSE_DATA);
+    } else {
+      ps2Hold(MOUSE_DATA);
+    }
+    ok = ps2WaitLine(MOUSE_CLOCK, HIGH, PS2_BIT_TIMEOUT_US) && ps2WaitLine(MOUSE_CLOCK, LOW, PS2_BIT_TIMEOUT_US);
+  }
+
+  // Stop bit, then the pad pulls data low for one clock to acknowledge the frame
+  ps2Release(MOUSE_DATA);
+  ok = ok && ps2WaitLine(MOUSE_DATA, LOW, PS2_BIT_TIMEOUT_US) && ps2WaitLine(MOUSE_CLOCK, LOW, PS2_BIT_TIMEOUT_US);
+  ok = ok && ps2WaitLine(MOUSE_CLOCK, HIGH, PS2_BIT_TIMEOUT_US) && ps2WaitLine(MOUSE_DATA, HIGH, PS2_BIT_TIMEOUT_US);
+
+  ps2Hold(MOUSE_CLOCK);
+  return ok;
+}
+
+// Function to read the next command response byte (0x00 and padTimedOut set on timeout)
 uint8_t waitForByte() {
-  return mouse.read();  // Blocks until a byte is received
+  int16_t data = padRead(PAD_RESPONSE_TIMEOUT_MS);
+  if (data < 0) {
+    padTimedOut = true;
+    return 0x00;
+  }
+  return data;
+}
+
+// Function to send a byte to the touchpad
+void padWrite(uint8_t data) {
+  if (!ps2Write(data)) {
+    padTimedOut = true;
+  }
 }
 
 // Global variables to store capabilities
@@ -17,6 +113,9 @@ bool isCapMultiFinger = false;
 bool isCapPalmDetect = false;
 uint8_t currentWmode = 0;
 
+// Finger count reported by advanced gesture mode packets (0 = not reported)
+uint8_t agmFingerCount = 0;
+
 // Function to extract infoMajor from Model ID
 // For Model ID 0x0 0x09 0x0, assume infoMajor=4 based on infoSensor=9
 uint8_t extractInfoMajor(uint8_t modelID1, uint8_t modelID2, uint8_t modelID3) {
@@ -29,7 +128,7 @@ uint8_t extractInfoMajor(uint8_t modelID1, uint8_t modelID2, uint8_t modelID3) {
 
 // Function to query touchpad status and return the status bytes
 void queryStatus(uint8_t &status1, uint8_t &status2, uint8_t &status3) {
-  mouse.write(0xE9);            // Request Status
+  padWrite(0xE9);            // Request Status
   uint8_t ack = waitForByte();  // Expect ACK
   Serial.print("ACK for Request Status: 0x");
   Serial.println(ack, HEX);
@@ -68,7 +167,7 @@ void queryModelID() {
   Serial.println("Querying Model ID...");
 
   // Send the Identify command
-  mouse.write(0xF2);
+  padWrite(0xF2);
 
   // Read ACK (0xFA)
   uint8_t ack = waitForByte();
@@ -117,7 +216,7 @@ void queryAndSetWmode(uint8_t desiredWmode) {
   Serial.println("Querying and setting Wmode...");
 
   // Query current status to check Wmode
-  mouse.write(0xE9);            // Request Status
+  padWrite(0xE9);            // Request Status
   uint8_t ack = waitForByte();  // ACK
   Serial.print("ACK for Request Status: 0x");
   Serial.println(ack, HEX);
@@ -138,27 +237,26 @@ void queryAndSetWmode(uint8_t desiredWmode) {
 
     // Encode mode byte for Wmode = desiredWmode
     // The exact sequence depends on the touchpad's protocol; adjust as necessary
-    mouse.write(0xE8);
-    mouse.write(0x03);
+    padWrite(0xE8);
+    padWrite(0x03);
     waitForByte();  // Example: Bits 7-6: Absolute mode, Wmode enabled
-    mouse.write(0xE8);
-    mouse.write(0x00);
+    padWrite(0xE8);
+    padWrite(0x00);
     waitForByte();  // Bits 5-4: Reserved, set to 0
-    mouse.write(0xE8);
-    mouse.write(0x00);
+    padWrite(0xE8);
+    padWrite(0x00);
     waitForByte();  // Bits 3-2: Reserved, set to 0
-    mouse.write(0xE8);
-    mouse.write(desiredWmode & 0x01);
+    padWrite(0xE8);
+    padWrite(desiredWmode & 0x01);
     waitForByte();  // Bit 1: Wmode on/off
 
     // Finalize Wmode setting with F3 14
-    mouse.write(0xF3);
-    mouse.write(0x14);  // Set Sample Rate to confirm
-    waitForByte();      // ACK for F3
-    waitForByte();      // ACK for 0x14
+    padWrite(0xF3);
+    padWrite(0x14);  // Set Sample Rate to confirm
+    waitForByte();      // ACK for 0x14 (the ACK for F3 is discarded by the second write)
 
     // Verify Wmode
-    mouse.write(0xE9);    // Request Status again
+    padWrite(0xE9);    // Request Status again
     ack = waitForByte();  // ACK
     status1 = waitForByte();
     status2 = waitForByte();
@@ -186,9 +284,9 @@ void setMode(uint8_t mode) {
   // Step 1: Send "Set Resolution" command with required values
   const uint8_t resolutions[] = { 0x00, 0x01, 0x02 };  // Resolutions for X, Y, Z axes
   for (int i = 0; i < 3; i++) {
-    mouse.write(0xE8);             // Set Resolution command
+    padWrite(0xE8);             // Set Resolution command
     uint8_t ack1 = waitForByte();  // ACK for E8
-    mouse.write(resolutions[i]);   // Send resolution value
+    padWrite(resolutions[i]);   // Send resolution value
     uint8_t ack2 = waitForByte();  // ACK for resolution value
     Serial.print("Set Resolution: ");
     Serial.print(resolutions[i], HEX);
@@ -199,23 +297,23 @@ void setMode(uint8_t mode) {
   }
 
   // Step 2: Encode the mode byte into four E8 commands
-  mouse.write(0xE8);
-  mouse.write((mode >> 6) & 0x03);
+  padWrite(0xE8);
+  padWrite((mode >> 6) & 0x03);
   waitForByte();  // Bits 7 and 6
-  mouse.write(0xE8);
-  mouse.write((mode >> 4) & 0x03);
+  padWrite(0xE8);
+  padWrite((mode >> 4) & 0x03);
   waitForByte();  // Bits 5 and 4
-  mouse.write(0xE8);
-  mouse.write((mode >> 2) & 0x03);
+  padWrite(0xE8);
+  padWrite((mode >> 2) & 0x03);
   waitForByte();  // Bits 3 and 2
-  mouse.write(0xE8);
-  mouse.write(mode & 0x03);
+  padWrite(0xE8);
+  padWrite(mode & 0x03);
   waitForByte();  // Bits 1 and 0
 
   // Step 3: Finalize the mode setting with Set Sample Rate
-  mouse.write(0xF3);             // Set Sample Rate command
+  padWrite(0xF3);             // Set Sample Rate command
   uint8_t ack3 = waitForByte();  // ACK for F3
-  mouse.write(0x14);             // Sample Rate 20 (as per absolute mode requirements)
+  padWrite(0x14);             // Sample Rate 20 (as per absolute mode requirements)
   uint8_t ack4 = waitForByte();  // ACK for 0x14
   Serial.print("Set Sample Rate: 20, ACK3: 0x");
   Serial.print(ack3, HEX);
@@ -225,6 +323,28 @@ void setMode(uint8_t mode) {
   Serial.println("New mode applied.");
 }
 
+// Function to enable advanced gesture mode (EWmode), needed for four-finger counts
+// Pads without support ignore it and keep reporting W=1 for three or more fingers
+void enableAdvancedGestureMode() {
+  Serial.println("Enabling advanced gesture mode...");
+
+  // Encode 0x03 into four E8 commands, then finalize with Set Sample Rate 0xC8
+  const uint8_t slices[] = { 0x00, 0x00, 0x00, 0x03 };
+  for (int i = 0; i < 4; i++) {
+    padWrite(0xE8);
+    padWrite(slices[i]);
+    waitForByte();
+  }
+  padWrite(0xF3);
+  uint8_t ack1 = waitForByte();  // ACK for F3
+  padWrite(0xC8);
+  uint8_t ack2 = waitForByte();  // ACK for 0xC8
+  Serial.print("Advanced gesture mode, ACK1: 0x");
+  Serial.print(ack1, HEX);
+  Serial.print(", ACK2: 0x");
+  Serial.println(ack2, HEX);
+}
+
 // Function to verify mode change
 void verifyModeChange() {
   Serial.println("Verifying mode change...");
@@ -237,8 +357,8 @@ void performMagicKnock() {
 
   // Send E8 00 four times to prepare for advanced mode
   for (int i = 0; i < 4; i++) {
-    mouse.write(0xE8);
-    mouse.write(0x00);
+    padWrite(0xE8);
+    padWrite(0x00);
     uint8_t ack = waitForByte();  // ACK
     Serial.print("Sent 0xE8 0x00, ACK: 0x");
     Serial.println(ack, HEX);
@@ -247,9 +367,9 @@ void performMagicKnock() {
   // Add the sample rate sequence as part of the magic knock
   const uint8_t sampleRates[] = { 200, 100, 80 };  // Required sample rates
   for (int i = 0; i < 3; i++) {
-    mouse.write(0xF3);             // Set Sample Rate command
+    padWrite(0xF3);             // Set Sample Rate command
     uint8_t ack1 = waitForByte();  // ACK for F3
-    mouse.write(sampleRates[i]);   // Send sample rate value
+    padWrite(sampleRates[i]);   // Send sample rate value
     uint8_t ack2 = waitForByte();  // ACK for sample rate value
     Serial.print("Set Sample Rate: ");
     Serial.print(sampleRates[i]);
@@ -263,7 +383,7 @@ void performMagicKnock() {
 // Function to disable data reporting
 void disableDataReporting() {
   Serial.println("Disabling data reporting...");
-  mouse.write(0xF5);            // Command to disable data reporting
+  padWrite(0xF5);            // Command to disable data reporting
   uint8_t ack = waitForByte();  // Expect 0xFA
   Serial.print("ACK from 0xF5: 0x");
   Serial.println(ack, HEX);
@@ -272,12 +392,182 @@ void disableDataReporting() {
 // Function to enable data reporting
 void enableDataReporting() {
   Serial.println("Enabling data reporting...");
-  mouse.write(0xF4);            // Command to enable data reporting
+  padWrite(0xF4);            // Command to enable data reporting
   uint8_t ack = waitForByte();  // Expect 0xFA
   Serial.print("ACK from 0xF4: 0x");
   Serial.println(ack, HEX);
 }
 
+// Function to reset the pad and wait for its self test (0xAA 0x00)
+void resetPad() {
+  Serial.println("Resetting touchpad...");
+  padWrite(0xFF);
+  int16_t ack = padRead(PAD_RESPONSE_TIMEOUT_MS);
+  int16_t selfTest = padRead(PAD_SELF_TEST_MS);
+  padRead(PAD_RESPONSE_TIMEOUT_MS);  // Device ID 0x00
+  Serial.print("ACK from 0xFF: 0x");
+  Serial.print(ack, HEX);
+  Serial.print(", self test: 0x");
+  Serial.println(selfTest, HEX);
+}
+
+// Function to put the pad into absolute mode with W and start reporting
+void configurePad() {
+  // Step 1: Perform the Synaptics "magic knock"
+  performMagicKnock();
+
+  // Step 2: Query current modes
+  queryModes();
+
+  // Step 3: Query Model ID and determine capabilities
+  queryModelID();
+
+  // Step 4: Query and set Wmode
+  queryAndSetWmode(1);  // Set Wmode to 1 if not already set
+
+  // Step 5: Disable data reporting
+  disableDataReporting();
+
+  // Step 6: Set Absolute Mode (0x8A as an example)
+  setMode(0x8A);
+
+  // Step 7: Enable advanced gesture mode for four-finger counts
+  if (isCapMultiFinger) {
+    enableAdvancedGestureMode();
+  }
+
+  // Step 8: Verify the mode change
+  verifyModeChange();
+
+  // Step 9: Enable data reporting
+  enableDataReporting();
+}
+
+// ---- Touchpad health monitor ----
+// A pad that resets (brown-out, cable wiggle) announces 0xAA 0x00 and comes back in relative mode
+// with reporting disabled. The monitor spots the announcement, misframed packets or silence and
+// reconfigures the pad from loop() without restarting the MKR.
+
+const unsigned long PAD_POLL_MS = 5;          // Longest wait for a packet before loop() moves on (bus timing)
+const unsigned long PAD_PACKET_BYTE_MS = 5;   // Longest gap between the bytes of one packet
+const unsigned long PAD_PROBE_MS = 500;       // Silence before the pad is asked for its status
+const uint8_t PAD_RESYNC_LIMIT = 12;          // Misframed bytes in a row before reconfiguring
+
+unsigned long lastPadByteTime = 0;  // Any byte from the pad, for the silence probe
+unsigned long lastPacketTime = 0;   // Last valid packet, for the outage time
+bool padResponding = true;
+uint8_t padMisframedRun = 0;
+uint32_t padResyncs = 0;
+uint32_t padRecoveries = 0;
+unsigned long lastRecoveryMs = 0;
+
+// Function to reconfigure a pad that lost absolute mode, and report how long it took
+void recoverPad() {
+  unsigned long start = millis();
+  lastPadByteTime = start;
+  padTimedOut = false;
+
+  // Stop whatever the pad streams now; no answer means it is still gone
+  padWrite(0xF5);
+  if ((waitForByte() != 0xFA) || padTimedOut) {
+    if (padResponding) {
+      Serial.println("Touchpad not responding.");
+      padResponding = false;
+    }
+    return;
+  }
+
+  configurePad();
+  if (padTimedOut) {
+    Serial.println("Touchpad recovery failed, retrying.");
+    return;
+  }
+
+  padResponding = true;
+  padMisframedRun = 0;
+  agmFingerCount = 0;
+  padRecoveries++;
+  lastRecoveryMs = millis() - start;
+  Serial.print("Touchpad recovered in ");
+  Serial.print(lastRecoveryMs);
+  Serial.print(" ms (no packets for ");
+  Serial.print(millis() - lastPacketTime);
+  Serial.println(" ms).");
+  lastPacketTime = millis();
+}
+
+// Function to check a silent pad: an idle pad answers a status request with reporting enabled
+void probePad() {
+  lastPadByteTime = millis();
+  padTimedOut = false;
+  padWrite(0xE9);
+  uint8_t ack = waitForByte();
+  uint8_t status1 = padTimedOut ? 0 : waitForByte();
+  if (!padTimedOut) {
+    waitForByte();
+    waitForByte();
+  }
+
+  if (padTimedOut || (ack != 0xFA) || !(status1 & 0x20)) {
+    recoverPad();  // Gone, or back from a reset with reporting disabled
+  } else if (!padResponding) {
+    padResponding = true;
+  }
+}
+
+// Function to count a byte that does not fit the absolute packet format
+void padMisframed() {
+  padResyncs++;
+  if (++padMisframedRun >= PAD_RESYNC_LIMIT) {
+    Serial.println("Touchpad packet format lost.");
+    recoverPad();
+  }
+}
+
+// Function to read one absolute mode packet, false if none arrived in time or it was misframed
+bool readPadPacket(uint8_t *packet) {
+  int16_t first = padRead(PAD_POLL_MS);
+  if (first < 0) {
+    if (millis() - lastPadByteTime >= PAD_PROBE_MS) {
+      probePad();
+    }
+    return false;
+  }
+  lastPadByteTime = millis();
+
+  // Self test announcement: the pad was reset and is back in relative mode
+  if (first == 0xAA) {
+    if (padRead(PAD_PACKET_BYTE_MS) == 0x00) {
+      Serial.println("Touchpad reset detected.");
+      recoverPad();
+      return false;
+    }
+  }
+
+  // Absolute packets: byte 1 is 10xx0xxx and byte 4 is 11xx0xxx; skip bytes until they line up
+  if ((first & 0xC8) != 0x80) {
+    padMisframed();
+    return false;
+  }
+  packet[0] = first;
+  for (uint8_t i = 1; i < 6; i++) {
+    int16_t data = padRead(PAD_PACKET_BYTE_MS);
+    if (data < 0) {
+      padMisframed();
+      return false;
+    }
+    packet[i] = data;
+  }
+  if ((packet[3] & 0xC8) != 0xC0) {
+    padMisframed();
+    return false;
+  }
+
+  padMisframedRun = 0;
+  lastPacketTime = millis();
+  return true;
+}
+
 // Define enums for directions and event types
 enum Direction {
   NONE,
@@ -295,11 +585,99 @@ const uint8_t MOVE_RIGHT = 0b011;    // 3
 const uint8_t MOVE_UP = 0b100;       // 4
 const uint8_t MOVE_DOWN = 0b101;     // 5
 
-// CMD_NONE remains as 0b00000 (0)
-const uint8_t CMD_NONE = 0b00000;  // 0
+// CMD_NONE remains as 0b000000 (0)
+const uint8_t CMD_NONE = 0b000000;  // 0
+
+// Bit 5 selects the extended command bank, bits 4-0 then hold an extended command
+const uint8_t CMD_EXTENDED = 0b100000;
+const uint8_t EXT_ROTOR_NEXT = 0b00001;  // Clockwise circle
+const uint8_t EXT_ROTOR_PREV = 0b00010;  // Counter-clockwise circle
+const uint8_t EXT_SCRUB = 0b00011;       // Two-finger Z
+const uint8_t EXT_HOME = 0b00100;        // Zone actions
+const uint8_t EXT_APP_SWITCHER = 0b00101;
+const uint8_t EXT_CONTROL_CENTER = 0b00110;
+const uint8_t EXT_ROTOR_UP = 0b00111;
+const uint8_t EXT_ROTOR_DOWN = 0b01000;
+
+// Define command pins (Digital Pins 0, 1, 2, 3, 7, 8)
+const uint8_t CMD_BITS = 6;
+const uint8_t commandPins[CMD_BITS] = { 0, 1, 2, 3, 7, 8 };
+
+// Gesture shape thresholds (in scaled delta units)
+const float ROTOR_TURN_RAD = 1.5f * PI;  // Total turning needed for a rotor circle (270 degrees)
+const int16_t ROTOR_MIN_STEP = 3;        // Ignore smaller steps when tracking the heading
+const int32_t ROTOR_MIN_PATH = 250;      // Minimum path length, so jitter on a resting finger is no circle
+const int32_t SCRUB_LEG_MIN = 40;        // Minimum length of each horizontal leg of the Z
+
+// Holding fingers still this long toggles a mode (two fingers: zone mode, three fingers: stream mode)
+const unsigned long MODE_HOLD_MS = 1500;
+
+// Swipe then hold: the direction command repeats, faster the longer the fingers stay down
+const unsigned long REPEAT_DELAY_MS = 300;           // Stillness after the swipe before the first repeat
+const unsigned long REPEAT_FIRST_INTERVAL_MS = 400;
+const unsigned long REPEAT_MIN_INTERVAL_MS = 80;     // Each interval is 3/4 of the previous one down to this
+const float REPEAT_STILL_TRAVEL = 15.0f;             // Scaled travel from the resting point that counts as moving again
+
+// Stream mode: one finger moves the pointer, two fingers scroll, sent to the ESP32 over Serial1
+// Frame: sync, flags, dx, dy, checksum (deltas in screen orientation, right and down positive)
+const uint8_t STREAM_SYNC = 0xA5;
+const uint8_t STREAM_SCROLL = 0x01;
+bool streamMode = false;
+
+// Function to send one pointer or scroll frame
+void sendStreamFrame(int16_t dx, int16_t dy, bool scroll) {
+  uint8_t frame[5];
+  frame[0] = STREAM_SYNC;
+  frame[1] = scroll ? STREAM_SCROLL : 0;
+  frame[2] = (uint8_t)(int8_t)constrain(dx, -127, 127);
+  frame[3] = (uint8_t)(int8_t)constrain(dy, -127, 127);
+  frame[4] = frame[1] ^ frame[2] ^ frame[3];
+  Serial1.write(frame, sizeof(frame));
+}
+
+// Zone mode: the pad is split into a grid, a one-finger tap on a zone sends its action
+// Rows run top to bottom along pad X (Down = +X), columns left to right along pad Y (Right = +Y)
+const uint8_t ZONE_ROWS = 3;
+const uint8_t ZONE_COLS = 3;
+const uint16_t PAD_MIN_X = 1472;  // Synaptics absolute coordinate range
+const uint16_t PAD_MAX_X = 5472;
+const uint16_t PAD_MIN_Y = 1408;
+const uint16_t PAD_MAX_Y = 4448;
+const uint8_t ZONE_LUT_SHIFT = 7;  // 13-bit coordinates, 64 buckets per axis
+const uint8_t ZONE_LUT_SIZE = (1 << 13) >> ZONE_LUT_SHIFT;
+
+// Extended command per zone (0 = no action, the tap is recognised as usual)
+uint8_t zoneActions[ZONE_ROWS][ZONE_COLS] = {
+  { EXT_HOME, EXT_ROTOR_UP, EXT_APP_SWITCHER },
+  { EXT_ROTOR_PREV, 0, EXT_ROTOR_NEXT },
+  { EXT_CONTROL_CENTER, EXT_ROTOR_DOWN, EXT_SCRUB },
+};
+
+// Precomputed coordinate bucket to row/column tables, so the lookup is two table reads
+uint8_t zoneRowOfX[ZONE_LUT_SIZE];
+uint8_t zoneColOfY[ZONE_LUT_SIZE];
+bool zoneMode = false;
+
+// Function to map a coordinate bucket onto one of the grid cells
+uint8_t zoneIndexOf(uint16_t raw, uint16_t minRaw, uint16_t maxRaw, uint8_t cells) {
+  if (raw <= minRaw) return 0;
+  if (raw >= maxRaw) return cells - 1;
+  return (uint32_t)(raw - minRaw) * cells / (maxRaw - minRaw);
+}
+
+// Function to precompute the zone tables
+void buildZoneTables() {
+  for (uint8_t i = 0; i < ZONE_LUT_SIZE; i++) {
+    uint16_t raw = ((uint16_t)i << ZONE_LUT_SHIFT) + (1 << (ZONE_LUT_SHIFT - 1));  // Bucket center
+    zoneRowOfX[i] = zoneIndexOf(raw, PAD_MIN_X, PAD_MAX_X, ZONE_ROWS);
+    zoneColOfY[i] = zoneIndexOf(raw, PAD_MIN_Y, PAD_MAX_Y, ZONE_COLS);
+  }
+}
 
-// Define command pins (Digital Pins 13, 12, 11, 10, 9)
-const uint8_t commandPins[5] = { 0, 1, 2, 3, 7 };
+// Function to look up the zone action at an absolute position
+uint8_t zoneActionAt(uint16_t rawX, uint16_t rawY) {
+  return zoneActions[zoneRowOfX[(rawX >> ZONE_LUT_SHIFT) % ZONE_LUT_SIZE]][zoneColOfY[(rawY >> ZONE_LUT_SHIFT) % ZONE_LUT_SIZE]];
+}
 
 // Function to convert direction to event type
 uint8_t getEventCode(const char *direction) {
@@ -316,101 +694,617 @@ uint8_t getEventCode(const char *direction) {
   }
 }
 
-// Function to send command via commandPins with serial prints
-void sendEncodedCommand(uint8_t cmd, unsigned long holdDuration = 15, bool printPins = true) {  // holdDuration in milliseconds
+// Runtime telemetry, printed and reset by the console "stats" command
+const uint8_t LATENCY_BUCKETS = 8;
+const uint16_t LATENCY_BOUNDS_MS[LATENCY_BUCKETS - 1] = { 50, 100, 200, 300, 400, 600, 800 };
+
+unsigned long statsStartTime = 0;
+uint32_t statPackets = 0;
+uint32_t statFiltered = 0;  // Packets with an unexpected status byte or W
+uint32_t statNoise = 0;     // Packets dropped by the noise filter
+uint32_t statCommands = 0;
+uint32_t statCommandsDropped = 0;  // Decided while the bus queue was full
+uint32_t statLoopCount = 0;
+uint32_t statLoopSumUs = 0;
+uint32_t statLoopMaxUs = 0;
+uint16_t latencyHistogram[LATENCY_BUCKETS];
+unsigned long gestureStartTime = 0;  // Start of the contact that completed the current gesture
+bool logIdle = true;                 // Print the idle cmd0 lines
+
+// Function to count a decision latency (contact start to command) in its histogram bucket
+void recordLatency(unsigned long latencyMs) {
+  uint8_t bucket = 0;
+  while ((bucket < LATENCY_BUCKETS - 1) && (latencyMs >= LATENCY_BOUNDS_MS[bucket])) {
+    bucket++;
+  }
+  latencyHistogram[bucket]++;
+}
+
+// Command bus state: a command is held on the pins, then CMD_NONE for a gap so the ESP32 sees
+// every command as a change, even the same command twice in a row
+enum BusState {
+  BUS_IDLE,
+  BUS_HOLD,
+  BUS_GAP
+};
+
+const unsigned long BUS_GAP_MS = 15;  // Longer than the ESP32 debounce (10 ms)
+const uint8_t CMD_QUEUE_LEN = 4;      // Commands decided while the bus is busy (rare, one bus cycle is 30 ms)
+
+BusState busState = BUS_IDLE;
+unsigned long busStateTime = 0;
+unsigned long busHoldDuration = 0;
+bool busPrintPins = false;
+
+// Commands waiting for the bus, oldest first
+uint8_t queuedCmd[CMD_QUEUE_LEN];
+unsigned long queuedHold[CMD_QUEUE_LEN];
+bool queuedPrint[CMD_QUEUE_LEN];
+uint8_t queuedHead = 0;
+uint8_t queuedCount = 0;
+
+// Function to put a command on the commandPins with serial prints; the pins are reset later by serviceCommandBus()
+void driveCommandPins(uint8_t cmd, unsigned long holdDuration, bool printPins) {
   if (printPins) {
     Serial.print("Sending cmd: ");
     Serial.println(cmd);
+  }
 
-    // Set each pin based on the corresponding bit in cmd
-    for (int i = 0; i < 5; i++) {
-      bool state = (cmd >> i) & 0x01;
-      digitalWrite(commandPins[i], state ? HIGH : LOW);
+  // Set each pin based on the corresponding bit in cmd
+  for (int i = 0; i < CMD_BITS; i++) {
+    bool state = (cmd >> i) & 0x01;
+    digitalWrite(commandPins[i], state ? HIGH : LOW);
 
-      // Print the state of each pin
+    // Print the state of each pin
+    if (printPins) {
       Serial.print("Pin ");
       Serial.print(commandPins[i]);
       Serial.print(": ");
       Serial.println(state ? "HIGH" : "LOW");
     }
+  }
 
-    // Hold the command for the specified duration to ensure detection
-    delay(holdDuration);
+  // Hold the command for the specified duration to ensure detection
+  busState = BUS_HOLD;
+  busStateTime = millis();
+  busHoldDuration = holdDuration;
+  busPrintPins = printPins;
+}
 
+// Function to advance the command bus without blocking (called from every loop)
+void serviceCommandBus() {
+  if ((busState == BUS_HOLD) && (millis() - busStateTime >= busHoldDuration)) {
     // Reset the command pins to LOW
-    for (int i = 0; i < 5; i++) {
+    for (int i = 0; i < CMD_BITS; i++) {
       digitalWrite(commandPins[i], LOW);
 
       // Print the reset state of each pin
-      Serial.print("Reset Pin ");
-      Serial.print(commandPins[i]);
-      Serial.println(": LOW");
-    }
-  } else {
-    // Set each pin based on the corresponding bit in cmd without printing
-    for (int i = 0; i < 5; i++) {
-      bool state = (cmd >> i) & 0x01;
-      digitalWrite(commandPins[i], state ? HIGH : LOW);
+      if (busPrintPins) {
+        Serial.print("Reset Pin ");
+        Serial.print(commandPins[i]);
+        Serial.println(": LOW");
+      }
     }
+    busState = BUS_GAP;
+    busStateTime = millis();
+  } else if ((busState == BUS_GAP) && (millis() - busStateTime >= BUS_GAP_MS)) {
+    busState = BUS_IDLE;
+  }
 
-    // Print only the cmd value
-    Serial.print("cmd");
+  // Bus free again: send the oldest queued command
+  if ((busState == BUS_IDLE) && (queuedCount > 0)) {
+    uint8_t slot = queuedHead;
+    queuedHead = (queuedHead + 1) % CMD_QUEUE_LEN;
+    queuedCount--;
+    driveCommandPins(queuedCmd[slot], queuedHold[slot], queuedPrint[slot]);
+  }
+}
+
+// Function to send a recognised command; it goes out now or, if the bus is busy, from serviceCommandBus()
+void sendEncodedCommand(uint8_t cmd, unsigned long holdDuration = 15, bool printPins = true) {  // holdDuration in milliseconds
+  // Counted when recognised, the latency is the recogniser's and not the bus queue's
+  statCommands++;
+  recordLatency(millis() - gestureStartTime);
+
+  if ((busState == BUS_IDLE) && (queuedCount == 0)) {
+    driveCommandPins(cmd, holdDuration, printPins);
+    return;
+  }
+
+  if (queuedCount == CMD_QUEUE_LEN) {
+    statCommandsDropped++;
+    Serial.print("Command queue full, dropped cmd: ");
     Serial.println(cmd);
+    return;
+  }
+  uint8_t slot = (queuedHead + queuedCount) % CMD_QUEUE_LEN;
+  queuedCmd[slot] = cmd;
+  queuedHold[slot] = holdDuration;
+  queuedPrint[slot] = printPins;
+  queuedCount++;
+}
 
-    // Hold the command for the specified duration
-    delay(holdDuration);
+// Per-user recogniser calibration, persisted to flash
+struct Calibration {
+  uint32_t magic;
+  float scale;             // Raw to scaled delta factor
+  int16_t swipeThreshold;  // Minimum scaled travel for a swipe
+  uint16_t clickTimeMs;    // Maximum duration for a click
+  uint16_t doubleClickMs;  // Maximum time between the ends of the two clicks of a double click
+  uint8_t zThreshold;      // Z below is idle, Z above is a contact
+};
 
-    // Reset the command pins to LOW without printing
-    for (int i = 0; i < 5; i++) {
-      digitalWrite(commandPins[i], LOW);
+const uint32_t CALIBRATION_MAGIC = 0x54424331;  // "TBC1"
+const Calibration DEFAULT_CALIBRATION = { CALIBRATION_MAGIC, 0.2f, 50, 90, 250, 15 };
+
+FlashStorage(calibrationStore, Calibration);
+Calibration cal = DEFAULT_CALIBRATION;
+Calibration savedCal = DEFAULT_CALIBRATION;
+
+// Guided calibration steps
+enum CalibrationStep {
+  CAL_OFF,
+  CAL_TAPS,
+  CAL_DOUBLE_TAPS,
+  CAL_SWIPES
+};
+
+const uint8_t CAL_SAMPLES = 5;   // Gestures per step
+const uint8_t CAL_Z_DETECT = 8;  // Low contact threshold while calibrating, so light touches count
+
+CalibrationStep calibrationStep = CAL_OFF;
+uint8_t calibrationCount = 0;
+uint16_t calTapMaxMs = 0;
+uint8_t calTapMinPeakZ = 255;
+int32_t calTapMaxTravel = 0;
+uint16_t calGapMaxMs = 0;
+unsigned long calLastTapEnd = 0;
+bool calSecondTap = false;
+int32_t calSwipeMinTravel = INT32_MAX;
+uint16_t calSwipeMinMs = UINT16_MAX;
+
+// Online drift adaptation: an integer EMA per feature, thresholds follow it slowly
+const uint8_t ADAPT_TAP = 0;
+const uint8_t ADAPT_DOUBLE_CLICK = 1;
+const uint8_t ADAPT_SWIPE = 2;
+
+const uint16_t ADAPT_SAVE_EVERY = 200;  // Gestures between flash writes (limits flash wear)
+
+int32_t tapTimeEma = 0;
+int32_t doubleClickGapEma = 0;
+int32_t swipeTravelEma = 0;
+uint16_t adaptedSinceSave = 0;
+
+// Seed the adaptation averages so the current thresholds are the steady state
+void resetAdaptation() {
+  tapTimeEma = (int32_t)cal.clickTimeMs * 2 / 3;
+  doubleClickGapEma = (int32_t)cal.doubleClickMs * 2 / 3;
+  swipeTravelEma = (int32_t)cal.swipeThreshold * 2;
+  adaptedSinceSave = 0;
+}
+
+void printCalibration() {
+  Serial.print("Calibration - scale: ");
+  Serial.print(cal.scale);
+  Serial.print(", swipe: ");
+  Serial.print(cal.swipeThreshold);
+  Serial.print(", click: ");
+  Serial.print(cal.clickTimeMs);
+  Serial.print(" ms, double click: ");
+  Serial.print(cal.doubleClickMs);
+  Serial.print(" ms, Z: ");
+  Serial.println(cal.zThreshold);
+}
+
+// Function to load the calibration from flash, falling back to the defaults
+void loadCalibration() {
+  Calibration stored = calibrationStore.read();
+  if (stored.magic == CALIBRATION_MAGIC) {
+    cal = stored;
+    Serial.println("Loaded calibration from flash.");
+  } else {
+    cal = DEFAULT_CALIBRATION;
+    Serial.println("No stored calibration, using defaults.");
+  }
+  savedCal = cal;
+  resetAdaptation();
+  printCalibration();
+}
+
+void saveCalibration() {
+  if (memcmp(&cal, &savedCal, sizeof(cal)) == 0) {
+    return;
+  }
+  calibrationStore.write(cal);
+  savedCal = cal;
+  Serial.println("Calibration saved to flash.");
+}
+
+// Function to start the guided calibration (taps, then double taps, then swipes)
+void startCalibration() {
+  calibrationStep = CAL_TAPS;
+  calibrationCount = 0;
+  calTapMaxMs = 0;
+  calTapMinPeakZ = 255;
+  calTapMaxTravel = 0;
+  calGapMaxMs = 0;
+  calSecondTap = false;
+  calSwipeMinTravel = INT32_MAX;
+  calSwipeMinMs = UINT16_MAX;
+  Serial.print("Calibration: tap once with one finger, ");
+  Serial.print(CAL_SAMPLES);
+  Serial.println(" times.");
+}
+
+// Function to derive the thresholds from the collected samples
+void finishCalibration() {
+  calibrationStep = CAL_OFF;
+
+  // Click time: between the slowest tap and the fastest swipe
+  uint16_t clickTime = calTapMaxMs + calTapMaxMs / 2;
+  if (calSwipeMinMs > calTapMaxMs) {
+    clickTime = min(clickTime, (uint16_t)((calTapMaxMs + calSwipeMinMs) / 2));
+  }
+  cal.clickTimeMs = constrain(clickTime, 50, 250);
+
+  // Double click window: the slowest double tap with some margin
+  cal.doubleClickMs = constrain(calGapMaxMs + calGapMaxMs / 2, 150, 500);
+
+  // Swipe threshold: between the largest tap travel and the shortest swipe
+  int32_t swipeThreshold = calTapMaxTravel * 2;
+  if (calSwipeMinTravel > calTapMaxTravel) {
+    swipeThreshold = (calTapMaxTravel + calSwipeMinTravel) / 2;
+  }
+  cal.swipeThreshold = constrain(swipeThreshold, 20, 150);
+
+  // Contact threshold: half of the lightest tap
+  cal.zThreshold = constrain(calTapMinPeakZ / 2, CAL_Z_DETECT, 40);
+
+  Serial.println("Calibration complete.");
+  printCalibration();
+  resetAdaptation();
+  saveCalibration();
+}
+
+// Function to feed a finished contact to the guided calibration
+void calibrationContact(unsigned long duration, int32_t travel, uint8_t peakZ) {
+  if ((calibrationStep == CAL_TAPS) || (calibrationStep == CAL_DOUBLE_TAPS)) {
+    calTapMaxMs = max(calTapMaxMs, (uint16_t)min(duration, 1000UL));
+    calTapMinPeakZ = min(calTapMinPeakZ, peakZ);
+    calTapMaxTravel = max(calTapMaxTravel, travel);
+  }
+
+  if (calibrationStep == CAL_DOUBLE_TAPS) {
+    // Contacts come in pairs, the gap is measured between the ends of both taps
+    if (calSecondTap) {
+      calGapMaxMs = max(calGapMaxMs, (uint16_t)min(millis() - calLastTapEnd, 1000UL));
+      calSecondTap = false;
+    } else {
+      calLastTapEnd = millis();
+      calSecondTap = true;
+      return;
     }
   }
+
+  if (calibrationStep == CAL_SWIPES) {
+    calSwipeMinTravel = min(calSwipeMinTravel, travel);
+    calSwipeMinMs = min(calSwipeMinMs, (uint16_t)min(duration, 1000UL));
+  }
+
+  calibrationCount++;
+  Serial.print("Calibration: ");
+  Serial.print(calibrationCount);
+  Serial.print("/");
+  Serial.println(CAL_SAMPLES);
+  if (calibrationCount < CAL_SAMPLES) {
+    return;
+  }
+
+  calibrationCount = 0;
+  if (calibrationStep == CAL_TAPS) {
+    calibrationStep = CAL_DOUBLE_TAPS;
+    Serial.print("Calibration: double tap with one finger, ");
+    Serial.print(CAL_SAMPLES);
+    Serial.println(" times.");
+  } else if (calibrationStep == CAL_DOUBLE_TAPS) {
+    calibrationStep = CAL_SWIPES;
+    Serial.print("Calibration: swipe with one finger in any direction, ");
+    Serial.print(CAL_SAMPLES);
+    Serial.println(" times.");
+  } else {
+    finishCalibration();
+  }
 }
 
-void setup() {
-  Serial.begin(115200);
-  mouse.initialize();
-  Serial.println("Mouse initialized in stream mode.");
+// Move a threshold a sixteenth of the way towards its target
+int32_t nudgeToward(int32_t current, int32_t target, int32_t lo, int32_t hi) {
+  target = constrain(target, lo, hi);
+  return current + (target - current) / 16;
+}
 
-  // Step 1: Perform the Synaptics "magic knock"
-  performMagicKnock();
+// Function to adapt the thresholds to a recognised gesture (called on every gesture)
+void adaptToGesture(uint8_t kind, int32_t sample) {
+  switch (kind) {
+    case ADAPT_TAP:
+      tapTimeEma += (sample - tapTimeEma) / 8;
+      cal.clickTimeMs = nudgeToward(cal.clickTimeMs, tapTimeEma * 3 / 2, 50, 250);
+      break;
+    case ADAPT_DOUBLE_CLICK:
+      doubleClickGapEma += (sample - doubleClickGapEma) / 8;
+      cal.doubleClickMs = nudgeToward(cal.doubleClickMs, doubleClickGapEma * 3 / 2, 150, 500);
+      break;
+    case ADAPT_SWIPE:
+      swipeTravelEma += (sample - swipeTravelEma) / 8;
+      cal.swipeThreshold = nudgeToward(cal.swipeThreshold, swipeTravelEma / 2, 20, 150);
+      break;
+  }
 
-  // Step 2: Query current modes
-  queryModes();
+  if (++adaptedSinceSave >= ADAPT_SAVE_EVERY) {
+    adaptedSinceSave = 0;
+    saveCalibration();
+  }
+}
 
-  // Step 3: Query Model ID and determine capabilities
-  queryModelID();
+// Function to find the swipe direction of the accumulated deltas ("None" below the swipe threshold)
+const char *swipeDirection(int32_t sumDX, int32_t sumDY) {
+  if (abs(sumDX) > abs(sumDY)) {
+    // Horizontal movement on the trackpad (translating to vertical movement in our application)
+    if (sumDX > cal.swipeThreshold) return "Down";
+    else if (sumDX < -cal.swipeThreshold) return "Up";
+  } else {
+    // Vertical movement on the trackpad (translating to horizontal movement in our application)
+    if (sumDY < -cal.swipeThreshold) return "Left";
+    else if (sumDY > cal.swipeThreshold) return "Right";
+  }
+  return "None";
+}
 
-  // Step 4: Query and set Wmode
-  queryAndSetWmode(1);  // Set Wmode to 1 if not already set
+// ---- Serial console ----
+// Line-based commands for tuning on the body: telemetry, live thresholds and the zone table.
+
+const uint8_t CONSOLE_LINE_MAX = 48;
+char consoleLine[CONSOLE_LINE_MAX];
+uint8_t consoleLength = 0;
+
+void printConsoleHelp() {
+  Serial.println("Commands:");
+  Serial.println("  stats                      packet rate, loop time, drops, latency histogram (then reset)");
+  Serial.println("  get                        thresholds and modes");
+  Serial.println("  set <name> <value>         scale, swipe, click, double, z, zone, stream, log");
+  Serial.println("  zone <row> <col> <action>  zone mode action (0 = none)");
+  Serial.println("  save                       store the thresholds in flash");
+  Serial.println("  defaults                   restore the default thresholds");
+  Serial.println("  cal                        guided calibration");
+}
 
-  // Step 5: Disable data reporting
-  disableDataReporting();
+void printStats() {
+  unsigned long elapsed = millis() - statsStartTime;
+  Serial.print("Packets: ");
+  Serial.print(statPackets);
+  Serial.print(" (");
+  Serial.print(elapsed > 0 ? statPackets * 1000.0f / elapsed : 0.0f);
+  Serial.print("/s), filtered: ");
+  Serial.print(statFiltered);
+  Serial.print(", noise: ");
+  Serial.print(statNoise);
+  Serial.print(", resynced bytes: ");
+  Serial.println(padResyncs);
+
+  Serial.print("Pad: ");
+  Serial.print(padResponding ? "responding" : "not responding");
+  Serial.print(", recoveries: ");
+  Serial.print(padRecoveries);
+  Serial.print(", last recovery: ");
+  Serial.print(lastRecoveryMs);
+  Serial.println(" ms");
+
+  Serial.print("Loop: avg ");
+  Serial.print(statLoopCount > 0 ? statLoopSumUs / statLoopCount : 0);
+  Serial.print(" us, max ");
+  Serial.print(statLoopMaxUs);
+  Serial.println(" us");
+
+  Serial.print("Commands: ");
+  Serial.print(statCommands);
+  Serial.print(", dropped: ");
+  Serial.print(statCommandsDropped);
+  Serial.print(", queued: ");
+  Serial.print(queuedCount);
+  Serial.print("/");
+  Serial.print(CMD_QUEUE_LEN);
+  Serial.print(", stream TX free: ");
+  Serial.println(Serial1.availableForWrite());
+
+  Serial.print("Latency (ms):");
+  for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+    Serial.print(i < LATENCY_BUCKETS - 1 ? " <" : " >=");
+    Serial.print(LATENCY_BOUNDS_MS[i < LATENCY_BUCKETS - 1 ? i : i - 1]);
+    Serial.print(":");
+    Serial.print(latencyHistogram[i]);
+  }
+  Serial.println();
+}
 
-  // Step 6: Set Absolute Mode (0x8A as an example)
-  setMode(0x8A);
+void resetStats() {
+  statsStartTime = millis();
+  statPackets = 0;
+  statFiltered = 0;
+  statNoise = 0;
+  statCommands = 0;
+  statCommandsDropped = 0;
+  statLoopCount = 0;
+  statLoopSumUs = 0;
+  statLoopMaxUs = 0;
+  padResyncs = 0;
+  padRecoveries = 0;
+  memset(latencyHistogram, 0, sizeof(latencyHistogram));
+}
 
-  // Step 7: Verify the mode change
-  verifyModeChange();
+void printSettings() {
+  printCalibration();
+  Serial.print("Zone mode: ");
+  Serial.print(zoneMode ? "on" : "off");
+  Serial.print(", stream mode: ");
+  Serial.print(streamMode ? "on" : "off");
+  Serial.print(", log: ");
+  Serial.println(logIdle ? "on" : "off");
+  Serial.print("Zones:");
+  for (uint8_t row = 0; row < ZONE_ROWS; row++) {
+    Serial.print(" [");
+    for (uint8_t col = 0; col < ZONE_COLS; col++) {
+      Serial.print(zoneActions[row][col]);
+      Serial.print(col < ZONE_COLS - 1 ? " " : "]");
+    }
+  }
+  Serial.println();
+}
 
-  // Step 8: Enable data reporting
-  enableDataReporting();
+// Function to apply "set <name> <value>", with the same bounds as the drift adaptation
+bool setParameter(const char *name, const char *value) {
+  float number = atof(value);
+  if (strcmp(name, "scale") == 0 && number >= 0.05f && number <= 1.0f) {
+    cal.scale = number;
+  } else if (strcmp(name, "swipe") == 0 && number >= 20 && number <= 150) {
+    cal.swipeThreshold = number;
+  } else if (strcmp(name, "click") == 0 && number >= 50 && number <= 250) {
+    cal.clickTimeMs = number;
+  } else if (strcmp(name, "double") == 0 && number >= 150 && number <= 500) {
+    cal.doubleClickMs = number;
+  } else if (strcmp(name, "z") == 0 && number >= 4 && number <= 80) {
+    cal.zThreshold = number;
+  } else if (strcmp(name, "zone") == 0) {
+    zoneMode = (number != 0);
+    return true;
+  } else if (strcmp(name, "stream") == 0) {
+    streamMode = (number != 0);
+    return true;
+  } else if (strcmp(name, "log") == 0) {
+    logIdle = (number != 0);
+    return true;
+  } else {
+    return false;
+  }
+
+  // Let the drift adaptation start from the new value instead of pulling it back
+  resetAdaptation();
+  return true;
+}
+
+void runConsoleCommand(char *line) {
+  const char *command = strtok(line, " ");
+  const char *arg1 = strtok(NULL, " ");
+  const char *arg2 = strtok(NULL, " ");
+  const char *arg3 = strtok(NULL, " ");
+
+  if (command == NULL) {
+    return;
+  }
+
+  if (strcmp(command, "help") == 0) {
+    printConsoleHelp();
+  } else if (strcmp(command, "stats") == 0) {
+    printStats();
+    resetStats();
+  } else if (strcmp(command, "get") == 0) {
+    printSettings();
+  } else if (strcmp(command, "set") == 0 && arg2 != NULL) {
+    if (setParameter(arg1, arg2)) {
+      printSettings();
+    } else {
+      Serial.println("Unknown name or value out of range.");
+    }
+  } else if (strcmp(command, "zone") == 0 && arg3 != NULL) {
+    uint8_t row = atoi(arg1);
+    uint8_t col = atoi(arg2);
+    uint8_t action = atoi(arg3);
+    if ((row < ZONE_ROWS) && (col < ZONE_COLS) && (action <= EXT_ROTOR_DOWN)) {
+      zoneActions[row][col] = action;
+      printSettings();
+    } else {
+      Serial.println("Zone or action out of range.");
+    }
+  } else if (strcmp(command, "save") == 0) {
+    saveCalibration();
+  } else if (strcmp(command, "defaults") == 0) {
+    cal = DEFAULT_CALIBRATION;
+    resetAdaptation();
+    printCalibration();
+  } else if ((strcmp(command, "cal") == 0) || (strcmp(command, "c") == 0)) {
+    startCalibration();
+  } else {
+    Serial.println("Unknown command, send 'help'.");
+  }
+}
+
+// Function to collect console input into lines and run each complete line
+void pollConsole() {
+  while (Serial.available()) {
+    char c = Serial.read();
+    if ((c == '\n') || (c == '\r')) {
+      if (consoleLength > 0) {
+        consoleLine[consoleLength] = '\0';
+        consoleLength = 0;
+        runConsoleCommand(consoleLine);
+      }
+    } else if (consoleLength < CONSOLE_LINE_MAX - 1) {
+      consoleLine[consoleLength++] = c;
+    }
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  Serial1.begin(115200);  // Stream mode link to the ESP32
+  ps2Release(MOUSE_CLOCK);
+  ps2Release(MOUSE_DATA);
+  resetPad();
+
+  // Absolute mode with W, advanced gestures and reporting
+  configurePad();
+  lastPacketTime = millis();
+  lastPadByteTime = millis();
 
   // Initialize command pins as outputs
-  for (int i = 0; i < 5; i++) {
+  for (int i = 0; i < CMD_BITS; i++) {
     pinMode(commandPins[i], OUTPUT);
     digitalWrite(commandPins[i], LOW);  // Set all command pins to LOW initially
   }
 
+  // Load the per-user thresholds
+  loadCalibration();
+
+  // Precompute the zone mode tables
+  buildZoneTables();
+
   Serial.println("Configuration complete.");
+  Serial.println("Send 'help' for the console commands, 'cal' to start calibration.");
+  resetStats();
 }
 
 void loop() {
-  // 1) Read 6 bytes from Synaptics (Absolute mode)
+  // Processing time of the previous packet, up to this loop start (covers the early returns)
+  static unsigned long packetDoneMicros = 0;
+  if (packetDoneMicros != 0) {
+    uint32_t loopMicros = micros() - packetDoneMicros;
+    statLoopCount++;
+    statLoopSumUs += loopMicros;
+    statLoopMaxUs = max(statLoopMaxUs, loopMicros);
+    packetDoneMicros = 0;
+  }
+
+  // Release the command pins once a command was held long enough
+  serviceCommandBus();
+
+  // Console commands (calibration, telemetry, live thresholds)
+  pollConsole();
+
+  // 1) Read 6 bytes from Synaptics (Absolute mode), the health monitor runs while none arrive
   uint8_t packet[6];
-  for (int i = 0; i < 6; i++) {
-    packet[i] = waitForByte();
+  if (!readPadPacket(packet)) {
+    return;
   }
+  packetDoneMicros = micros();
+  statPackets++;
 
   // 2) Extract fields
   uint8_t b1 = packet[0];
@@ -439,26 +1333,40 @@ void loop() {
   uint8_t w0 = (b4 >> 2) & 0x01;
   uint8_t W = (w32 << 2) | (w1 << 1) | w0;
 
+  // W=2 is an advanced gesture mode packet, the contact type carries the finger count
+  if (W == 2) {
+    if (((b6 >> 4) & 0x03) == 2) {
+      agmFingerCount = b2;
+    }
+    return;
+  }
+
   // Only handle if status is {0x80, 0x90} and W is in {0, 1, 4}
   bool validStatus = ((statusByte == 0x80) || (statusByte == 0x90));
   bool validW = ((W == 0) || (W == 1) || (W == 4));
   if (!validStatus || !validW) {
+    statFiltered++;
     return;
   }
 
   // Determine fingerCount based on status and W
+  uint8_t zThreshold = (calibrationStep != CAL_OFF) ? CAL_Z_DETECT : cal.zThreshold;
   uint8_t fingerCount = 0;
-  if ((statusByte == 0x80) && (Z < 15)) {
+  if ((statusByte == 0x80) && (Z < zThreshold)) {
     fingerCount = 0;  // idle
-  } else if ((statusByte == 0x90) && (W == 4) && (Z > 15)) {
+  } else if ((statusByte == 0x90) && (W == 4) && (Z > zThreshold)) {
     fingerCount = 1;
-  } else if ((statusByte == 0x80) && (W == 0) && (Z > 15)) {
+  } else if ((statusByte == 0x80) && (W == 0) && (Z > zThreshold)) {
     fingerCount = 2;
-  } else if ((statusByte == 0x80) && (W == 1) && (Z > 15)) {
-    fingerCount = 3;
+  } else if ((statusByte == 0x80) && (W == 1) && (Z > zThreshold)) {
+    fingerCount = (agmFingerCount >= 4) ? 4 : 3;
   }
   // else => 0 fallback
 
+  if (fingerCount == 0) {
+    agmFingerCount = 0;
+  }
+
   // 3) Compute relative deltas
   static uint16_t oldX = 0, oldY = 0;
   int16_t diffX = (int16_t)rawX - (int16_t)oldX;
@@ -466,14 +1374,14 @@ void loop() {
   oldX = rawX;
   oldY = rawY;
 
-  static const float ST = 0.2f;
-  float scaledDX = ST * (float)diffX;
-  float scaledDY = ST * (float)diffY;
+  float scaledDX = cal.scale * (float)diffX;
+  float scaledDY = cal.scale * (float)diffY;
   int16_t dX = (int16_t)scaledDX;
   int16_t dY = (int16_t)scaledDY;
 
   // If movement deltas are too large, consider it as noise and ignore
   if ((abs(dX) > 200) || (abs(dY) > 200)) {
+    statNoise++;
     return;
   }
 
@@ -482,16 +1390,37 @@ void loop() {
   static unsigned int freq1 = 0, freq2 = 0, freq3 = 0;
   static int32_t sumDX = 0, sumDY = 0;
   static unsigned long movementStartTime = 0;
+  static uint8_t peakZ = 0;
+  static uint16_t touchX = 0, touchY = 0;
+  static bool holdFired = false;
 
-  // Override for 3-finger
+  // Override for 3-finger and 4-finger
   static bool hasSeen3 = false;
+  static bool hasSeen4 = false;
+
+  // Rotor: accumulated turning of the trajectory heading
+  static float turnAngle = 0.0f;
+  static int32_t turnPath = 0;
+  static float lastHeading = 0.0f;
+  static bool hasHeading = false;
+
+  // Scrub: direction reversals along the horizontal axis (pad Y)
+  static int8_t scrubDir = 0;
+  static int32_t scrubExtreme = 0;
+  static uint8_t scrubTurns = 0;
+
+  // Swipe then hold auto-repeat
+  static uint8_t repeatCmd = CMD_NONE;  // Command being repeated, CMD_NONE when not repeating
+  static bool repeatDone = false;       // Moving again ended the repeat, the rest of the contact is ignored
+  static unsigned long nextRepeatTime = 0;
+  static unsigned long repeatInterval = 0;
+  static uint16_t stillX = 0, stillY = 0;  // Raw resting point (the summed deltas drift by their rounding)
+  static unsigned long stillSince = 0;
 
   // Variables for single click detection
   static bool pendingSingleClick = false;
   static unsigned long pendingClickTime = 0;
   static uint8_t pendingClickCount = 0;
-  const unsigned long DOUBLE_CLICK_MS = 250;  // Threshold for double click
-  const unsigned long CLICK_TIME_MS = 90;     // Maximum duration for a click (ms)
 
   // Variable to track if an event was handled in this loop
   bool eventHandled = false;
@@ -504,9 +1433,30 @@ void loop() {
     sumDX = 0;
     sumDY = 0;
     movementStartTime = millis();
+    gestureStartTime = movementStartTime;
+    peakZ = 0;
+    touchX = rawX;
+    touchY = rawY;
+    holdFired = false;
 
-    // Reset the 3-finger override
+    // Reset the 3-finger and 4-finger overrides
     hasSeen3 = false;
+    hasSeen4 = false;
+
+    // Reset the shape trackers
+    turnAngle = 0.0f;
+    turnPath = 0;
+    hasHeading = false;
+    scrubDir = 0;
+    scrubExtreme = 0;
+    scrubTurns = 0;
+
+    // Reset the auto-repeat
+    repeatCmd = CMD_NONE;
+    repeatDone = false;
+    stillX = rawX;
+    stillY = rawY;
+    stillSince = movementStartTime;
   }
   // Handle movement end
   else if ((fingerCount == 0) && movementInProgress) {
@@ -517,37 +1467,90 @@ void loop() {
 
     // Determine finger count at the end of movement
     uint8_t finalCount = 0;
-    if (hasSeen3) {
+    if (hasSeen4) {
+      finalCount = 4;
+    } else if (hasSeen3) {
       finalCount = 3;
     } else {
       if (freq1 >= freq2) finalCount = 1;
       else finalCount = 2;
     }
 
-    // Determine direction based on accumulated deltas
-    const char *direction = "None";
-    if (abs(sumDX) > abs(sumDY)) {
-      // Horizontal movement on the trackpad (translating to vertical movement in our application)
-      if (sumDX > 50) direction = "Down";
-      else if (sumDX < -50) direction = "Up";
-    } else {
-      // Vertical movement on the trackpad (translating to horizontal movement in our application)
-      if (sumDY < -50) direction = "Left";
-      else if (sumDY > 50) direction = "Right";
+    // Travel along the dominant axis
+    int32_t travel = max(abs(sumDX), abs(sumDY));
+
+    // Calibration consumes the contact instead of recognising it
+    if (calibrationStep != CAL_OFF) {
+      calibrationContact(duration, travel, peakZ);
+      return;
+    }
+
+    // The contact already toggled a mode or auto-repeated while it was held
+    if (holdFired || (repeatCmd != CMD_NONE) || repeatDone) {
+      return;
     }
 
-    // Check if the movement duration is less than CLICK_TIME_MS (90 ms)
+    // In stream mode movement was already streamed, only taps are still recognised
+    if (streamMode && (travel >= cal.swipeThreshold)) {
+      return;
+    }
+
+    // Determine direction based on accumulated deltas
+    const char *direction = swipeDirection(sumDX, sumDY);
+
+    // Check if the movement duration is less than the calibrated click time
     bool isClick = false;
-    if ((finalCount >= 1) && (finalCount <= 3)) {
-      if (duration < CLICK_TIME_MS) {
+    if ((finalCount >= 1) && (finalCount <= 4)) {
+      if (duration < cal.clickTimeMs) {
         isClick = true;
       }
     }
 
+    // Shape gestures take priority: a circle for the rotor, a two-finger Z for scrub
+    uint8_t extCmd = 0;
+    bool isCircle = (finalCount >= 1) && (finalCount <= 2) && (turnPath >= ROTOR_MIN_PATH);
+    if (isCircle && (turnAngle <= -ROTOR_TURN_RAD)) {
+      extCmd = EXT_ROTOR_NEXT;  // Clockwise
+    } else if (isCircle && (turnAngle >= ROTOR_TURN_RAD)) {
+      extCmd = EXT_ROTOR_PREV;  // Counter-clockwise
+    } else if ((finalCount == 2) && (scrubTurns >= 2)) {
+      extCmd = EXT_SCRUB;
+    }
+
+    // Zone mode: a one-finger tap on a zone with an action sends it without waiting for a double click
+    uint8_t zoneCmd = 0;
+    if (zoneMode && (finalCount == 1) && (isClick || strcmp(direction, "None") == 0)) {
+      zoneCmd = zoneActionAt(touchX, touchY);
+    }
+
     // Handle Click or Movement based on duration
-    if (isClick || (strcmp(direction, "None") == 0 && finalCount > 0)) {
-      // Click Handling
-      if (pendingSingleClick && (millis() - pendingClickTime < DOUBLE_CLICK_MS) && (pendingClickCount == finalCount)) {
+    if (extCmd != 0) {
+      Serial.print("Shape Detected: ");
+      Serial.println(extCmd == EXT_SCRUB ? "Scrub" : (extCmd == EXT_ROTOR_NEXT ? "Rotor Next" : "Rotor Previous"));
+
+      uint8_t cmd = CMD_EXTENDED | extCmd;
+      sendEncodedCommand(cmd, 15, true);
+      eventHandled = true;
+
+      // A shape is never the first half of a double click
+      pendingSingleClick = false;
+    } else if (zoneCmd != 0) {
+      Serial.print("Zone Tap: action ");
+      Serial.println(zoneCmd);
+
+      uint8_t cmd = CMD_EXTENDED | zoneCmd;
+      sendEncodedCommand(cmd, 15, true);
+      eventHandled = true;
+      pendingSingleClick = false;
+    } else if (isClick || (strcmp(direction, "None") == 0 && finalCount > 0)) {
+      // Click Handling, only quick taps tune the click time (slow taps are clicks anyway)
+      if ((travel < cal.swipeThreshold) && (duration < cal.clickTimeMs)) {
+        adaptToGesture(ADAPT_TAP, duration);
+      }
+
+      if (pendingSingleClick && (millis() - pendingClickTime < cal.doubleClickMs) && (pendingClickCount == finalCount)) {
+        adaptToGesture(ADAPT_DOUBLE_CLICK, millis() - pendingClickTime);
+
         // Double Click detected
         Serial.print("** DOUBLE CLICK with ");
         Serial.print(finalCount);
@@ -572,6 +1575,8 @@ void loop() {
       }
 
     } else if (finalCount > 0) {
+      adaptToGesture(ADAPT_SWIPE, travel);
+
       // Movement occurred
       Serial.print("Movement Detected: Direction=");
       Serial.print(direction);
@@ -594,7 +1599,9 @@ void loop() {
 
   // If in a movement, accumulate finger counts and deltas
   if (movementInProgress) {
-    if (fingerCount == 3) {
+    if (fingerCount == 4) {
+      hasSeen4 = true;
+    } else if (fingerCount == 3) {
       hasSeen3 = true;
     } else if (fingerCount == 1) {
       freq1++;
@@ -603,11 +1610,107 @@ void loop() {
     }
     sumDX += dX;
     sumDY += dY;
+    if (Z > peakZ) {
+      peakZ = Z;
+    }
+
+    // Track the heading of significant steps and sum up the signed turning
+    if ((abs(dX) + abs(dY)) >= ROTOR_MIN_STEP) {
+      turnPath += abs(dX) + abs(dY);
+      float heading = atan2((float)dY, (float)dX);
+      if (hasHeading) {
+        float delta = heading - lastHeading;
+        if (delta > PI) delta -= 2.0f * PI;
+        else if (delta < -PI) delta += 2.0f * PI;
+        turnAngle += delta;
+      }
+      lastHeading = heading;
+      hasHeading = true;
+    }
+
+    // Count reversals once the position retreats SCRUB_LEG_MIN from the last extreme
+    if (scrubDir == 0) {
+      if (abs(sumDY) > SCRUB_LEG_MIN) {
+        scrubDir = (sumDY > 0) ? 1 : -1;
+        scrubExtreme = sumDY;
+      }
+    } else if ((sumDY - scrubExtreme) * scrubDir > 0) {
+      scrubExtreme = sumDY;
+    } else if (abs(sumDY - scrubExtreme) > SCRUB_LEG_MIN) {
+      scrubDir = -scrubDir;
+      scrubExtreme = sumDY;
+      scrubTurns++;
+    }
+
+    // Stream the deltas: pad Y is screen right, pad X is screen down
+    if (streamMode && ((fingerCount == 1) || (fingerCount == 2)) && ((dX != 0) || (dY != 0))) {
+      sendStreamFrame(dY, dX, fingerCount == 2);
+    }
+
+    // Swipe then hold: any movement restarts the stillness timer and ends a running repeat
+    if (cal.scale * (abs((int16_t)rawX - (int16_t)stillX) + abs((int16_t)rawY - (int16_t)stillY)) > REPEAT_STILL_TRAVEL) {
+      stillX = rawX;
+      stillY = rawY;
+      stillSince = millis();
+      if (repeatCmd != CMD_NONE) {
+        repeatCmd = CMD_NONE;
+        repeatDone = true;
+      }
+    }
+
+    const char *holdDirection = swipeDirection(sumDX, sumDY);
+    bool canRepeat = !repeatDone && !holdFired && !streamMode && (calibrationStep == CAL_OFF);
+    if (canRepeat && (repeatCmd == CMD_NONE) && (strcmp(holdDirection, "None") != 0) && (millis() - stillSince >= REPEAT_DELAY_MS)) {
+      uint8_t holdCount = hasSeen4 ? 4 : (hasSeen3 ? 3 : ((freq1 >= freq2) ? 1 : 2));
+      repeatCmd = ((holdCount - 1) << 3) | getEventCode(holdDirection);
+      repeatInterval = REPEAT_FIRST_INTERVAL_MS;
+      nextRepeatTime = millis();
+      pendingSingleClick = false;
+
+      Serial.print("Repeat Started: Direction=");
+      Serial.print(holdDirection);
+      Serial.print(", Finger Count=");
+      Serial.println(holdCount);
+    }
+
+    // Scheduled from the packet stream, no blocking wait between repeats
+    if ((repeatCmd != CMD_NONE) && ((long)(millis() - nextRepeatTime) >= 0)) {
+      gestureStartTime = nextRepeatTime;  // Latency of a repeat is how late it went out
+      sendEncodedCommand(repeatCmd, 15, false);
+      Serial.print("Repeat cmd");
+      Serial.print(repeatCmd);
+      Serial.print(", next in ");
+      Serial.print(repeatInterval);
+      Serial.println(" ms");
+      eventHandled = true;
+
+      nextRepeatTime = millis() + repeatInterval;
+      repeatInterval = max(REPEAT_MIN_INTERVAL_MS, repeatInterval * 3 / 4);
+    }
+
+    // Fingers held still toggle a mode: two fingers zone mode, three fingers stream mode
+    bool twoFingers = (freq2 > freq1) && !hasSeen3 && !hasSeen4;
+    bool threeFingers = hasSeen3 && !hasSeen4;
+    bool still = (abs(sumDX) < cal.swipeThreshold) && (abs(sumDY) < cal.swipeThreshold);
+    if (!holdFired && still && (millis() - movementStartTime >= MODE_HOLD_MS)) {
+      if (twoFingers) {
+        holdFired = true;
+        zoneMode = !zoneMode;
+        Serial.println(zoneMode ? "Zone mode on." : "Zone mode off.");
+      } else if (threeFingers) {
+        holdFired = true;
+        streamMode = !streamMode;
+        Serial.println(streamMode ? "Stream mode on." : "Stream mode off.");
+      }
+      if (holdFired) {
+        pendingSingleClick = false;
+      }
+    }
   }
 
   // 5) Handle Pending Single Clicks
   if (pendingSingleClick) {
-    if (millis() - pendingClickTime >= DOUBLE_CLICK_MS) {
+    if (millis() - pendingClickTime >= cal.doubleClickMs) {
       // Time elapsed without a second click; confirm single click
       Serial.print("** SINGLE CLICK with ");
       Serial.print(pendingClickCount);
@@ -628,9 +1731,8 @@ void loop() {
     }
   }
 
-  // 6) If no event was handled in this loop, set command pins to CMD_NONE (00000) without printing pin states
-  if (!eventHandled) {
-    sendEncodedCommand(CMD_NONE, 15, false);  // CMD_NONE = 0b00000, holdDuration=2ms, printPins=false
+  // 6) If no event was handled in this loop the bus returns to CMD_NONE (000000) on its own
+  if (!eventHandled && logIdle) {
     Serial.print("cmd");
     Serial.println(CMD_NONE);
   }
@@ -1,8 +1,59 @@
 #include <Arduino.h>
-#include <BleKeyboard.h>
+#include <BleComboKeyboard.h>
+#include <BleComboMouse.h>
+#include <BLEDevice.h>
+#include <Preferences.h>
+#include <esp_gap_ble_api.h>
+#include <esp_gatts_api.h>
+#include <esp_mac.h>
 
-// BLE Keyboard Initialization
-BleKeyboard bleKeyboard;
+// BLE Keyboard + Mouse Initialization (composite HID descriptor)
+BleComboKeyboard bleKeyboard("ESP32 Keyboard");
+BleComboMouse bleMouse(&bleKeyboard);
+
+// Set to 1 to log every HID report with a timestamp, also without a connected host
+#define HID_RECORDER 0
+
+// Time the last gesture command appeared on the bus (for the recorder latency)
+unsigned long cmdEdgeMicros = 0;
+
+// Host slots: each slot advertises its own BT address so every host keeps its own bond
+const uint8_t MAX_HOST_SLOTS = 3;
+const unsigned long SLOT_CHORD_MS = 1500;    // Hold Home + Rotor this long to switch host
+const unsigned long DIRECTED_ADV_MS = 1280;  // High duty directed advertising limit (BLE spec)
+
+// Bonded host remembered for a slot
+struct HostPeer {
+  uint8_t valid;
+  uint8_t addrType;
+  uint8_t addr[6];
+};
+
+Preferences prefs;
+uint8_t hostSlot = 0;
+HostPeer hostPeer = {};
+HostPeer bondedPeer = {};            // Written from the BLE task, saved from loop()
+volatile bool bondedPeerPending = false;
+volatile bool bleAdvertising = false;  // The library started advertising, so the BLE stack is up
+bool directedAdvActive = false;
+unsigned long directedAdvStart = 0;
+unsigned long reconnectStartTime = 0;  // 0 = measure from boot (covers a slot switch restart)
+
+// Pointer/scroll stream from the Arduino MKR (Serial2 RX, 5-byte frames)
+#define STREAM_RX_PIN 16
+const uint8_t STREAM_SYNC = 0xA5;
+const uint8_t STREAM_SCROLL = 0x01;
+const int32_t STREAM_SCROLL_DIV = 8;  // Pointer units per wheel step
+
+// Deltas received since the last report, sent once per connection interval
+int32_t streamDX = 0;
+int32_t streamDY = 0;
+int32_t streamScrollX = 0;
+int32_t streamScrollY = 0;
+volatile uint16_t connIntervalMs = 0;   // From the connection parameters, 0 = not known yet
+volatile uint16_t connLatency = 0;      // Slave latency, in connection events
+volatile uint16_t connTimeoutMs = 0;    // Supervision timeout
+const uint16_t DEFAULT_INTERVAL_MS = 15;  // Pacing while no interval is known (recorder without a host)
 
 // Gesture input pins
 #define CMD_PIN0 23 // 23
@@ -10,6 +61,7 @@ BleKeyboard bleKeyboard;
 #define CMD_PIN2 21 // 21
 #define CMD_PIN3 19 // 19
 #define CMD_PIN4 18 // 18
+#define CMD_PIN5 17 // 17
 
 // Button input pins
 #define BTN_HOME 26
@@ -30,23 +82,87 @@ const uint8_t MOVE_UP        = 0b00100;
 const uint8_t MOVE_DOWN      = 0b00101;
 const uint8_t SINGLE_CLICK   = 0b00110;
 
+// Extended command bank (bit 5 set, bits 4-0 hold the extended command)
+const uint8_t CMD_EXTENDED   = 0b100000;
+const uint8_t EXT_ROTOR_NEXT = 0b00001;
+const uint8_t EXT_ROTOR_PREV = 0b00010;
+const uint8_t EXT_SCRUB      = 0b00011;
+const uint8_t EXT_HOME       = 0b00100;
+const uint8_t EXT_APP_SWITCHER   = 0b00101;
+const uint8_t EXT_CONTROL_CENTER = 0b00110;
+const uint8_t EXT_ROTOR_UP   = 0b00111;
+const uint8_t EXT_ROTOR_DOWN = 0b01000;
+
 // Maximum fingers supported
-const uint8_t MAX_FINGERS = 3;
+const uint8_t MAX_FINGERS = 4;
 
 // Debounce delay
 const unsigned long debounceDelay = 10;
 
+// Gesture keys (VO + key), editable from the console and stored in NVS
+const uint8_t GESTURE_EVENTS = 6;  // Event codes 1 (double click) to 6 (single click)
+const char *const EVENT_NAMES[GESTURE_EVENTS] = { "dclick", "left", "right", "up", "down", "click" };
+const char DEFAULT_GESTURE_KEYS[MAX_FINGERS][GESTURE_EVENTS] = {
+  { 'a', 'b', 'c', 'd', 'e', 'f' },
+  { 'g', 'h', 'i', 'j', 'k', 'l' },
+  { 'm', 'n', 'o', 'p', 'q', 'r' },
+  { 's', 't', 'u', 'v', 'w', 'x' }
+};
+char gestureKeys[MAX_FINGERS][GESTURE_EVENTS];
+
+// Gesture keystrokes are paced to BLE delivery: a keystroke is KEYSTROKE_REPORTS reports, about one
+// per connection event, and a keystroke that arrives sooner waits in a single slot (latest wins)
+const uint8_t KEYSTROKE_REPORTS = 5;
+unsigned long lastKeystrokeTime = 0;
+uint8_t pendingKeystrokeFingers = 0;  // 0 = nothing pending
+uint8_t pendingKeystrokeEvent = 0;
+
+// Runtime telemetry, printed and reset by the console "stats" command
+const uint8_t LATENCY_BUCKETS = 8;
+const uint16_t LATENCY_BOUNDS_MS[LATENCY_BUCKETS - 1] = { 11, 12, 15, 20, 30, 50, 100 };
+
+unsigned long statsStartTime = 0;
+uint32_t statLoopCount = 0;
+uint32_t statLoopSumUs = 0;
+uint32_t statLoopMaxUs = 0;
+uint32_t statBusCommands = 0;
+uint32_t statStreamFrames = 0;
+uint32_t statStreamBad = 0;       // Frames with a wrong checksum
+uint32_t statStreamSkipped = 0;   // Bytes skipped while resyncing
+uint32_t statStreamReports = 0;
+uint32_t statKeystrokesDeferred = 0;  // Waited for the previous keystroke to be delivered
+uint32_t statKeystrokesReplaced = 0;  // Overwritten in the pending slot by a newer one
+uint16_t statStreamQueueMax = 0;  // Deepest Serial2 RX backlog seen
+uint16_t latencyHistogram[LATENCY_BUCKETS];
+unsigned long lastReconnectMs = 0;
+
 void setup() {
   Serial.begin(115200);
+
+  // Select the host slot before the BT controller starts so it picks up the slot address
+  loadHostSlot();
+  selectHostIdentity();
+  BLEDevice::setCustomGapHandler(onGapEvent);
+  BLEDevice::setCustomGattsHandler(onGattsEvent);
+
+  // begin() only starts the library's BLE task; loop() turns to the known host once it advertises
   Serial.println("Starting BLE Keyboard...");
   bleKeyboard.begin();
 
+  // Stream mode link from the Arduino MKR
+  Serial2.begin(115200, SERIAL_8N1, STREAM_RX_PIN, -1);
+
+  loadKeyMap();
+  resetStats();
+  Serial.println("Send 'help' for the console commands.");
+
   // Configure gesture pins as input with pull-down resistors
   pinMode(CMD_PIN0, INPUT_PULLDOWN);
   pinMode(CMD_PIN1, INPUT_PULLDOWN);
   pinMode(CMD_PIN2, INPUT_PULLDOWN);
   pinMode(CMD_PIN3, INPUT_PULLDOWN);
   pinMode(CMD_PIN4, INPUT_PULLDOWN);
+  pinMode(CMD_PIN5, INPUT_PULLDOWN);
 
   // Configure button pins as input with pull-down resistors
   pinMode(BTN_HOME, INPUT_PULLUP);
@@ -59,8 +175,42 @@ void loop() {
   static unsigned long lastReadTime = 0;
   static uint8_t stableCmd = CMD_NONE;
   static bool commandChanged = false;
+  static bool wasConnected = false;
+  unsigned long loopStartMicros = micros();
 
-  if (bleKeyboard.isConnected()) {
+  // Console commands (telemetry, key mapping)
+  pollConsole();
+
+  bool connected = bleKeyboard.isConnected();
+  if (connected != wasConnected) {
+    handleConnectionChange(connected);
+    wasConnected = connected;
+  }
+
+  // The stack is up once the library's own (undirected) advertising started: try the known host first
+  static bool bootAdvertisingDone = false;
+  if (!bootAdvertisingDone && bleAdvertising) {
+    bootAdvertisingDone = true;
+    if (!connected && hostPeer.valid && !startDirectedAdvertising()) {
+      startUndirectedAdvertising();
+    }
+  }
+
+  // Directed advertising times out after DIRECTED_ADV_MS, then let any host find us
+  if (directedAdvActive && !connected && (millis() - directedAdvStart >= DIRECTED_ADV_MS)) {
+    directedAdvActive = false;
+    startUndirectedAdvertising();
+  }
+
+  if (bondedPeerPending) {
+    bondedPeerPending = false;
+    saveHostPeer(bondedPeer);
+  }
+
+  // Host switching must also work while disconnected
+  checkHostSwitchChord();
+
+  if (connected || HID_RECORDER) {
     // Read gesture pin states
     uint8_t cmd = 0;
     cmd |= digitalRead(CMD_PIN0) << 0;
@@ -68,11 +218,13 @@ void loop() {
     cmd |= digitalRead(CMD_PIN2) << 2;
     cmd |= digitalRead(CMD_PIN3) << 3;
     cmd |= digitalRead(CMD_PIN4) << 4;
+    cmd |= digitalRead(CMD_PIN5) << 5;
 
     // Detect command changes
     if (cmd != stableCmd) {
       commandChanged = true;
       lastReadTime = millis();
+      cmdEdgeMicros = micros();
       stableCmd = cmd;
     }
 
@@ -80,6 +232,13 @@ void loop() {
       commandChanged = false;
 
       if (stableCmd != CMD_NONE) {
+        statBusCommands++;
+      }
+
+      if (stableCmd & CMD_EXTENDED) {
+        handleExtendedCommand(stableCmd & 0b11111);
+        recordLatency(micros() - cmdEdgeMicros);
+      } else if (stableCmd != CMD_NONE) {
         uint8_t fingerIndex = (stableCmd >> 3) & 0b11;
         uint8_t fingerCount = fingerIndex + 1;
         if (fingerCount > MAX_FINGERS) {
@@ -88,12 +247,29 @@ void loop() {
 
         uint8_t eventCode = stableCmd & 0b00111;
         handleGesture(fingerCount, eventCode);
+        recordLatency(micros() - cmdEdgeMicros);
       }
     }
 
     handleButtons();
+    sendPendingKeystroke();
+  } else {
+    pendingKeystrokeFingers = 0;  // Don't replay a stale keystroke on reconnect
   }
 
+  // Pointer/scroll stream, batched into one report per connection interval
+  readStreamFrames();
+  if (connected || HID_RECORDER) {
+    sendStreamReport();
+  } else {
+    streamDX = streamDY = streamScrollX = streamScrollY = 0;  // Don't replay movement on reconnect
+  }
+
+  uint32_t loopMicros = micros() - loopStartMicros;
+  statLoopCount++;
+  statLoopSumUs += loopMicros;
+  statLoopMaxUs = max(statLoopMaxUs, loopMicros);
+
   delay(1);
 }
 
@@ -141,54 +317,105 @@ void handleGesture(uint8_t fingerCount, uint8_t eventCode) {
 }
 
 void sendGestureCommand(uint8_t fingerCount, uint8_t eventCode) {
+  // Still delivering the previous keystroke: keep only the newest one (auto-repeat must not queue up)
+  if (millis() - lastKeystrokeTime < KEYSTROKE_REPORTS * reportIntervalMs()) {
+    if (pendingKeystrokeFingers != 0) {
+      statKeystrokesReplaced++;
+    }
+    statKeystrokesDeferred++;
+    pendingKeystrokeFingers = fingerCount;
+    pendingKeystrokeEvent = eventCode;
+    return;
+  }
+  sendGestureKeystroke(fingerCount, eventCode);
+}
+
+// Function to send the pending keystroke once the previous one had time to go out
+void sendPendingKeystroke() {
+  if ((pendingKeystrokeFingers == 0) || (millis() - lastKeystrokeTime < KEYSTROKE_REPORTS * reportIntervalMs())) {
+    return;
+  }
+  uint8_t fingerCount = pendingKeystrokeFingers;
+  pendingKeystrokeFingers = 0;
+  sendGestureKeystroke(fingerCount, pendingKeystrokeEvent);
+}
+
+void sendGestureKeystroke(uint8_t fingerCount, uint8_t eventCode) {
+  lastKeystrokeTime = millis();
+
   // Determine unique key for the combination of fingerCount and eventCode
   char key = getUniqueKey(fingerCount, eventCode);
 
   // Send the key using BLE keyboard
-  bleKeyboard.press(VO_CTRL);
-  bleKeyboard.press(VO_ALT);
-  bleKeyboard.write(key);
-  bleKeyboard.releaseAll();
+  hidPress(VO_CTRL);
+  hidPress(VO_ALT);
+  hidWrite(key);
+  hidReleaseAll();
 }
 
 char getUniqueKey(uint8_t fingerCount, uint8_t eventCode) {
   // Map each finger count and event code to a unique key
-  // Example: ASCII codes for keys 'A' to 'Z', 'a' to 'z', etc.
   Serial.print("eventCode:");
   Serial.println(eventCode);
-  switch (fingerCount) {
-    case 1:
-      switch (eventCode) {
-        case DOUBLE_CLICK: return 'a';
-        case MOVE_LEFT:    return 'b';
-        case MOVE_RIGHT:   return 'c';
-        case MOVE_UP:      return 'd';
-        case MOVE_DOWN:    return 'e';
-        case SINGLE_CLICK: return 'f';
-      }
+  if ((fingerCount >= 1) && (fingerCount <= MAX_FINGERS) && (eventCode >= 1) && (eventCode <= GESTURE_EVENTS)) {
+    return gestureKeys[fingerCount - 1][eventCode - 1];
+  }
+  return 'z'; // Default fallback key if no match
+}
+
+void handleExtendedCommand(uint8_t extCmd) {
+  switch (extCmd) {
+    case EXT_ROTOR_NEXT:
+      Serial.println("Action: Rotor Next (VO + Command + Right Arrow)");
+      sendRotor(KEY_RIGHT_ARROW);
       break;
-    case 2:
-      switch (eventCode) {
-        case DOUBLE_CLICK: return 'g';
-        case MOVE_LEFT:    return 'h';
-        case MOVE_RIGHT:   return 'i';
-        case MOVE_UP:      return 'j';
-        case MOVE_DOWN:    return 'k';
-        case SINGLE_CLICK: return 'l';
-      }
+    case EXT_ROTOR_PREV:
+      Serial.println("Action: Rotor Previous (VO + Command + Left Arrow)");
+      sendRotor(KEY_LEFT_ARROW);
       break;
-    case 3:
-      switch (eventCode) {
-        case DOUBLE_CLICK: return 'm';
-        case MOVE_LEFT:    return 'n';
-        case MOVE_RIGHT:   return 'o';
-        case MOVE_UP:      return 'p';
-        case MOVE_DOWN:    return 'q';
-        case SINGLE_CLICK: return 'r';
-      }
+    case EXT_SCRUB:
+      Serial.println("Action: Scrub (Escape)");
+      hidWrite(KEY_ESC);
+      break;
+    case EXT_HOME:
+      Serial.println("Action: Home (Command + H)");
+      sendCommandShortcut('h');
+      break;
+    case EXT_APP_SWITCHER:
+      Serial.println("Action: App Switcher (Command + Up Arrow)");
+      sendCommandShortcut(KEY_UP_ARROW);
+      break;
+    case EXT_CONTROL_CENTER:
+      Serial.println("Action: Control Center (Command + C)");
+      sendCommandShortcut('c');
+      break;
+    case EXT_ROTOR_UP:
+      // Same key as a one-finger swipe up
+      Serial.println("Action: Rotor Up");
+      sendGestureCommand(1, MOVE_UP);
+      break;
+    case EXT_ROTOR_DOWN:
+      Serial.println("Action: Rotor Down");
+      sendGestureCommand(1, MOVE_DOWN);
       break;
+    default:
+      Serial.print("Action: Unknown extended command ");
+      Serial.println(extCmd);
   }
-  return 'z'; // Default fallback key if no match
+}
+
+void sendRotor(uint8_t arrowKey) {
+  hidPress(VO_CTRL);
+  hidPress(VO_ALT);
+  hidPress(KEY_LEFT_GUI);
+  hidWrite(arrowKey);
+  hidReleaseAll();
+}
+
+void sendCommandShortcut(uint8_t key) {
+  hidPress(KEY_LEFT_GUI);
+  hidWrite(key);
+  hidReleaseAll();
 }
 
 // Variables to store the previous states of each button
@@ -196,6 +423,7 @@ bool prevHomeState = HIGH;
 bool prevAppSwitcherState = HIGH;
 bool prevControlCenterState = HIGH;
 bool prevRotorState = HIGH;
+bool chordUsed = false;  // Home and Rotor were held together since both were last released
 
 void handleButtons() {
   // Read the current state of each button
@@ -204,35 +432,36 @@ void handleButtons() {
   bool controlCenterState = digitalRead(BTN_CONTROL_CENTER);
   bool rotorState = digitalRead(BTN_ROTOR);
 
-  // Detect transition from HIGH to LOW for each button
-  if (homeState == LOW && prevHomeState == HIGH) {
+  // Home + Rotor together is the host switch chord, so these two act on release
+  // and send nothing once they have been held together
+  if (homeState == LOW && rotorState == LOW) {
+    chordUsed = true;
+  }
+
+  if (!chordUsed && homeState == HIGH && prevHomeState == LOW) {
     Serial.println("Action: Home (Command + H)");
-    bleKeyboard.press(KEY_LEFT_GUI);
-    bleKeyboard.write('h');
-    bleKeyboard.releaseAll();
+    sendCommandShortcut('h');
   }
 
+  // Detect transition from HIGH to LOW for the other buttons
+
   if (appSwitcherState == LOW && prevAppSwitcherState == HIGH) {
     Serial.println("Action: App Switcher (Command + Up Arrow)");
-    bleKeyboard.press(KEY_LEFT_GUI);
-    bleKeyboard.write(KEY_UP_ARROW);
-    bleKeyboard.releaseAll();
+    sendCommandShortcut(KEY_UP_ARROW);
   }
 
   if (controlCenterState == LOW && prevControlCenterState == HIGH) {
     Serial.println("Action: Control Center (Command + C)");
-    bleKeyboard.press(KEY_LEFT_GUI);
-    bleKeyboard.write('c');
-    bleKeyboard.releaseAll();
+    sendCommandShortcut('c');
   }
 
-  if (rotorState == LOW && prevRotorState == HIGH) {
+  if (!chordUsed && rotorState == HIGH && prevRotorState == LOW) {
     Serial.println("Action: Rotor Switch (VO + Command + Right Arrow)");
-    bleKeyboard.press(VO_CTRL);
-    bleKeyboard.press(VO_ALT);
-    bleKeyboard.press(KEY_LEFT_GUI);
-    bleKeyboard.write(KEY_RIGHT_ARROW);
-    bleKeyboard.releaseAll();
+    sendRotor(KEY_RIGHT_ARROW);
+  }
+
+  if (homeState == HIGH && rotorState == HIGH) {
+    chordUsed = false;
   }
 
   // Update the previous states with the current states
@@ -241,3 +470,474 @@ void handleButtons() {
   prevControlCenterState = controlCenterState;
   prevRotorState = rotorState;
 }
+
+
+// Load the active host slot and its bonded host from NVS
+void loadHostSlot() {
+  prefs.begin("touchbelt", false);
+  hostSlot = prefs.getUChar("slot", 0);
+  if (hostSlot >= MAX_HOST_SLOTS) {
+    hostSlot = 0;
+  }
+
+  char key[8];
+  snprintf(key, sizeof(key), "peer%u", hostSlot);
+  if (prefs.getBytes(key, &hostPeer, sizeof(hostPeer)) != sizeof(hostPeer)) {
+    hostPeer.valid = 0;
+  }
+
+  Serial.print("Host slot: ");
+  Serial.print(hostSlot + 1);
+  Serial.println(hostPeer.valid ? " (bonded host known)" : " (no bonded host)");
+}
+
+// Derive a distinct BT address per slot; hosts key their bond on it, so it must not change between
+// boots. Slot 1 keeps the factory address. The chip owns only base to base + 3 of the universally
+// administered range, so the other slots set the locally administered bit and the slot number in
+// the first byte (like esp_derive_local_mac()), leaving the bytes the BT offset is added to alone.
+void selectHostIdentity() {
+  uint8_t mac[6];
+  esp_efuse_mac_get_default(mac);
+  if (hostSlot > 0) {
+    mac[0] = (mac[0] | 0x02) ^ ((hostSlot - 1) << 2);
+  }
+  esp_base_mac_addr_set(mac);
+}
+
+// Remember the host that just bonded on the active slot
+void saveHostPeer(const HostPeer &peer) {
+  if (hostPeer.valid && (memcmp(hostPeer.addr, peer.addr, sizeof(peer.addr)) == 0)) {
+    return;
+  }
+  hostPeer = peer;
+
+  char key[8];
+  snprintf(key, sizeof(key), "peer%u", hostSlot);
+  prefs.putBytes(key, &hostPeer, sizeof(hostPeer));
+  Serial.println("Bonded host saved for this slot.");
+}
+
+// GAP events from the BLE stack (runs in the BLE task)
+void onGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param) {
+  if ((event == ESP_GAP_BLE_AUTH_CMPL_EVT) && param->ble_security.auth_cmpl.success) {
+    bondedPeer.valid = 1;
+    bondedPeer.addrType = param->ble_security.auth_cmpl.addr_type;
+    memcpy(bondedPeer.addr, param->ble_security.auth_cmpl.bd_addr, sizeof(bondedPeer.addr));
+    bondedPeerPending = true;
+  }
+
+  if ((event == ESP_GAP_BLE_ADV_START_COMPLETE_EVT) && (param->adv_start_cmpl.status == ESP_BT_STATUS_SUCCESS)) {
+    bleAdvertising = true;
+  }
+
+  // Connection interval in 1.25 ms units, the stream reports follow it
+  if (event == ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT) {
+    connIntervalMs = max(7, (param->update_conn_params.conn_int * 5) / 4);
+    connLatency = param->update_conn_params.latency;
+    connTimeoutMs = param->update_conn_params.timeout * 10;
+  }
+}
+
+// GATTS events from the BLE stack (runs in the BLE task): the parameters the connection was made
+// with, kept unless the host updates them later
+void onGattsEvent(esp_gatts_cb_event_t event, esp_gatt_if_t gattsIf, esp_ble_gatts_cb_param_t *param) {
+  if (event == ESP_GATTS_CONNECT_EVT) {
+    connIntervalMs = max(7, (param->connect.conn_params.interval * 5) / 4);
+    connLatency = param->connect.conn_params.latency;
+    connTimeoutMs = param->connect.conn_params.timeout * 10;
+  } else if (event == ESP_GATTS_DISCONNECT_EVT) {
+    connIntervalMs = 0;
+    connLatency = 0;
+    connTimeoutMs = 0;
+  }
+}
+
+// Function to get the interval HID reports are paced to
+uint16_t reportIntervalMs() {
+  return (connIntervalMs != 0) ? connIntervalMs : DEFAULT_INTERVAL_MS;
+}
+
+// High duty directed advertising to the bonded host, the fastest way back to a known host
+bool startDirectedAdvertising() {
+  if (!hostPeer.valid) {
+    return false;
+  }
+
+  esp_ble_adv_params_t params = {};
+  params.adv_int_min = 0x20;
+  params.adv_int_max = 0x20;
+  params.adv_type = ADV_TYPE_DIRECT_IND_HIGH;
+  params.own_addr_type = BLE_ADDR_TYPE_PUBLIC;
+  memcpy(params.peer_addr, hostPeer.addr, sizeof(hostPeer.addr));
+  params.peer_addr_type = (esp_ble_addr_type_t)hostPeer.addrType;
+  params.channel_map = ADV_CHNL_ALL;
+  params.adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY;
+
+  // The caller falls back to undirected advertising if the controller rejects the request
+  esp_err_t err = esp_ble_gap_stop_advertising();
+  if (err == ESP_OK) {
+    err = esp_ble_gap_start_advertising(&params);
+  }
+  if (err != ESP_OK) {
+    Serial.print("Directed advertising failed: ");
+    Serial.println(esp_err_to_name(err));
+    return false;
+  }
+  directedAdvActive = true;
+  directedAdvStart = millis();
+  Serial.println("Directed advertising to bonded host...");
+  return true;
+}
+
+// Undirected advertising at the fast interval (20-40 ms) so hosts reconnect quickly
+void startUndirectedAdvertising() {
+  BLEAdvertising *advertising = BLEDevice::getAdvertising();
+  advertising->stop();
+  advertising->setMinInterval(0x20);
+  advertising->setMaxInterval(0x40);
+  advertising->start();
+}
+
+// Measure time to reconnect after a slot switch, a boot or the host going away
+void handleConnectionChange(bool connected) {
+  if (connected) {
+    directedAdvActive = false;
+    Serial.print("Host slot ");
+    Serial.print(hostSlot + 1);
+    Serial.print(" connected, reconnect time: ");
+    lastReconnectMs = millis() - reconnectStartTime;
+    Serial.print(lastReconnectMs);
+    Serial.print(" ms, interval ");
+    if (connIntervalMs != 0) {
+      Serial.print(connIntervalMs);
+      Serial.println(" ms");
+    } else {
+      Serial.println("unknown");
+    }
+  } else {
+    Serial.println("Host disconnected.");
+    reconnectStartTime = millis();
+    if (!startDirectedAdvertising()) {
+      startUndirectedAdvertising();
+    }
+  }
+}
+
+// Holding Home + Rotor switches to the next host slot (takes effect after a restart)
+void checkHostSwitchChord() {
+  static unsigned long chordStart = 0;
+  static bool chordDone = false;
+
+  bool chordHeld = (digitalRead(BTN_HOME) == LOW) && (digitalRead(BTN_ROTOR) == LOW);
+  if (!chordHeld) {
+    chordStart = 0;
+    chordDone = false;
+    return;
+  }
+
+  if (chordStart == 0) {
+    chordStart = millis();
+  } else if (!chordDone && (millis() - chordStart >= SLOT_CHORD_MS)) {
+    chordDone = true;
+    hostSlot = (hostSlot + 1) % MAX_HOST_SLOTS;
+    prefs.putUChar("slot", hostSlot);
+    Serial.print("Switching to host slot ");
+    Serial.println(hostSlot + 1);
+    Serial.flush();
+    ESP.restart();
+  }
+}
+
+// HID report helpers, the recorder logs each report with its time and the delay since the bus edge
+void recordReport(const char *type, uint8_t key) {
+#if HID_RECORDER
+  unsigned long now = micros();
+  Serial.print("HID ");
+  Serial.print(now);
+  Serial.print(" us ");
+  Serial.print(type);
+  Serial.print(" 0x");
+  Serial.print(key, HEX);
+  Serial.print(" +");
+  Serial.print(now - cmdEdgeMicros);
+  Serial.println(" us after bus edge");
+#endif
+}
+
+void hidPress(uint8_t key) {
+  recordReport("press", key);
+  if (bleKeyboard.isConnected()) {
+    bleKeyboard.press(key);
+  }
+}
+
+void hidWrite(uint8_t key) {
+  recordReport("write", key);
+  if (bleKeyboard.isConnected()) {
+    bleKeyboard.write(key);
+  }
+}
+
+void hidReleaseAll() {
+  recordReport("release", 0);
+  if (bleKeyboard.isConnected()) {
+    bleKeyboard.releaseAll();
+  }
+}
+
+void hidMove(int8_t x, int8_t y, int8_t wheel, int8_t hWheel) {
+#if HID_RECORDER
+  Serial.print("HID ");
+  Serial.print(micros());
+  Serial.print(" us move ");
+  Serial.print(x);
+  Serial.print(",");
+  Serial.print(y);
+  Serial.print(" wheel ");
+  Serial.print(wheel);
+  Serial.print(",");
+  Serial.println(hWheel);
+#endif
+  if (bleKeyboard.isConnected()) {
+    bleMouse.move(x, y, wheel, hWheel);
+  }
+}
+
+// Parse the stream frames from the Arduino MKR and add up their deltas
+void readStreamFrames() {
+  static uint8_t frame[5];
+  static uint8_t frameLength = 0;
+
+  statStreamQueueMax = max(statStreamQueueMax, (uint16_t)Serial2.available());
+  while (Serial2.available()) {
+    uint8_t data = Serial2.read();
+    if ((frameLength == 0) && (data != STREAM_SYNC)) {
+      statStreamSkipped++;
+      continue;  // Resync on the next sync byte
+    }
+    frame[frameLength++] = data;
+    if (frameLength < sizeof(frame)) {
+      continue;
+    }
+    frameLength = 0;
+
+    if ((frame[1] ^ frame[2] ^ frame[3]) != frame[4]) {
+      statStreamBad++;
+      continue;  // Corrupted frame
+    }
+    statStreamFrames++;
+    int8_t dx = (int8_t)frame[2];
+    int8_t dy = (int8_t)frame[3];
+    if (frame[1] & STREAM_SCROLL) {
+      streamScrollX += dx;
+      streamScrollY += dy;
+    } else {
+      streamDX += dx;
+      streamDY += dy;
+    }
+  }
+}
+
+// Send the batched deltas as one mouse report, keeping what does not fit for the next one
+void sendStreamReport() {
+  static unsigned long lastReportTime = 0;
+  if (millis() - lastReportTime < reportIntervalMs()) {
+    return;
+  }
+
+  int8_t x = constrain(streamDX, -127, 127);
+  int8_t y = constrain(streamDY, -127, 127);
+  // Natural scrolling: the content follows the fingers
+  int8_t wheel = constrain(streamScrollY / STREAM_SCROLL_DIV, -127, 127);
+  int8_t hWheel = constrain(-streamScrollX / STREAM_SCROLL_DIV, -127, 127);
+  if ((x == 0) && (y == 0) && (wheel == 0) && (hWheel == 0)) {
+    return;
+  }
+
+  hidMove(x, y, wheel, hWheel);
+  lastReportTime = millis();
+  statStreamReports++;
+  streamDX -= x;
+  streamDY -= y;
+  streamScrollY -= wheel * STREAM_SCROLL_DIV;
+  streamScrollX += hWheel * STREAM_SCROLL_DIV;
+}
+
+// ---- Serial console ----
+// Line-based commands for tuning on the body: telemetry and the gesture key mapping.
+
+const uint8_t CONSOLE_LINE_MAX = 48;
+char consoleLine[CONSOLE_LINE_MAX];
+uint8_t consoleLength = 0;
+
+// Load the gesture keys from NVS, falling back to the defaults
+void loadKeyMap() {
+  if (prefs.getBytes("keys", gestureKeys, sizeof(gestureKeys)) != sizeof(gestureKeys)) {
+    memcpy(gestureKeys, DEFAULT_GESTURE_KEYS, sizeof(gestureKeys));
+  }
+}
+
+// Function to count a bus edge to HID report latency in its histogram bucket
+void recordLatency(unsigned long latencyMicros) {
+  uint8_t bucket = 0;
+  while ((bucket < LATENCY_BUCKETS - 1) && (latencyMicros >= LATENCY_BOUNDS_MS[bucket] * 1000UL)) {
+    bucket++;
+  }
+  latencyHistogram[bucket]++;
+}
+
+void printConsoleHelp() {
+  Serial.println("Commands:");
+  Serial.println("  stats                        loop time, stream link, BLE parameters, latency histogram (then reset)");
+  Serial.println("  keys                         gesture key mapping");
+  Serial.println("  map <fingers> <event> <key>  event: dclick, left, right, up, down, click");
+  Serial.println("  save                         store the key mapping");
+  Serial.println("  defaults                     restore the default key mapping");
+}
+
+void printStats() {
+  unsigned long elapsed = millis() - statsStartTime;
+  Serial.print("Loop: ");
+  Serial.print(elapsed > 0 ? statLoopCount * 1000.0f / elapsed : 0.0f);
+  Serial.print("/s, avg ");
+  Serial.print(statLoopCount > 0 ? statLoopSumUs / statLoopCount : 0);
+  Serial.print(" us, max ");
+  Serial.print(statLoopMaxUs);
+  Serial.println(" us");
+
+  Serial.print("Bus commands: ");
+  Serial.print(statBusCommands);
+  Serial.print(", keystrokes deferred: ");
+  Serial.print(statKeystrokesDeferred);
+  Serial.print(", replaced: ");
+  Serial.println(statKeystrokesReplaced);
+
+  Serial.print("Stream: ");
+  Serial.print(statStreamFrames);
+  Serial.print(" frames, ");
+  Serial.print(statStreamBad);
+  Serial.print(" bad, ");
+  Serial.print(statStreamSkipped);
+  Serial.print(" bytes resynced, ");
+  Serial.print(statStreamReports);
+  Serial.print(" reports, RX queue max ");
+  Serial.print(statStreamQueueMax);
+  Serial.print(", pending dx/dy ");
+  Serial.print(streamDX);
+  Serial.print("/");
+  Serial.println(streamDY);
+
+  Serial.print("BLE: ");
+  Serial.print(bleKeyboard.isConnected() ? "connected" : "disconnected");
+  Serial.print(", slot ");
+  Serial.print(hostSlot + 1);
+  if (connIntervalMs != 0) {
+    Serial.print(", interval ");
+    Serial.print(connIntervalMs);
+    Serial.print(" ms, latency ");
+    Serial.print(connLatency);
+    Serial.print(", timeout ");
+    Serial.print(connTimeoutMs);
+    Serial.print(" ms");
+  } else {
+    Serial.print(", interval unknown");
+  }
+  Serial.print(", last reconnect ");
+  Serial.print(lastReconnectMs);
+  Serial.println(" ms");
+
+  Serial.print("Latency (ms):");
+  for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+    Serial.print(i < LATENCY_BUCKETS - 1 ? " <" : " >=");
+    Serial.print(LATENCY_BOUNDS_MS[i < LATENCY_BUCKETS - 1 ? i : i - 1]);
+    Serial.print(":");
+    Serial.print(latencyHistogram[i]);
+  }
+  Serial.println();
+}
+
+void resetStats() {
+  statsStartTime = millis();
+  statLoopCount = 0;
+  statLoopSumUs = 0;
+  statLoopMaxUs = 0;
+  statBusCommands = 0;
+  statStreamFrames = 0;
+  statStreamBad = 0;
+  statStreamSkipped = 0;
+  statStreamReports = 0;
+  statStreamQueueMax = 0;
+  statKeystrokesDeferred = 0;
+  statKeystrokesReplaced = 0;
+  memset(latencyHistogram, 0, sizeof(latencyHistogram));
+}
+
+void printKeyMap() {
+  for (uint8_t finger = 0; finger < MAX_FINGERS; finger++) {
+    Serial.print(finger + 1);
+    Serial.print(" finger:");
+    for (uint8_t event = 0; event < GESTURE_EVENTS; event++) {
+      Serial.print(" ");
+      Serial.print(EVENT_NAMES[event]);
+      Serial.print("=");
+      Serial.print(gestureKeys[finger][event]);
+    }
+    Serial.println();
+  }
+}
+
+void runConsoleCommand(char *line) {
+  const char *command = strtok(line, " ");
+  const char *arg1 = strtok(NULL, " ");
+  const char *arg2 = strtok(NULL, " ");
+  const char *arg3 = strtok(NULL, " ");
+
+  if (command == NULL) {
+    return;
+  }
+
+  if (strcmp(command, "help") == 0) {
+    printConsoleHelp();
+  } else if (strcmp(command, "stats") == 0) {
+    printStats();
+    resetStats();
+  } else if (strcmp(command, "keys") == 0) {
+    printKeyMap();
+  } else if (strcmp(command, "map") == 0 && arg3 != NULL) {
+    uint8_t fingers = atoi(arg1);
+    uint8_t event = 0;
+    while ((event < GESTURE_EVENTS) && (strcmp(arg2, EVENT_NAMES[event]) != 0)) {
+      event++;
+    }
+    if ((fingers >= 1) && (fingers <= MAX_FINGERS) && (event < GESTURE_EVENTS) && (strlen(arg3) == 1)) {
+      gestureKeys[fingers - 1][event] = arg3[0];
+      printKeyMap();
+    } else {
+      Serial.println("Usage: map <1-4> <dclick|left|right|up|down|click> <key>");
+    }
+  } else if (strcmp(command, "save") == 0) {
+    prefs.putBytes("keys", gestureKeys, sizeof(gestureKeys));
+    Serial.println("Key mapping saved.");
+  } else if (strcmp(command, "defaults") == 0) {
+    memcpy(gestureKeys, DEFAULT_GESTURE_KEYS, sizeof(gestureKeys));
+    printKeyMap();
+  } else {
+    Serial.println("Unknown command, send 'help'.");
+  }
+}
+
+// Function to collect console input into lines and run each complete line
+void pollConsole() {
+  while (Serial.available()) {
+    char c = Serial.read();
+    if ((c == '\n') || (c == '\r')) {
+      if (consoleLength > 0) {
+        consoleLine[consoleLength] = '\0';
+        consoleLength = 0;
+        runConsoleCommand(consoleLine);
+      }
+    } else if (consoleLength < CONSOLE_LINE_MAX - 1) {
+      consoleLine[consoleLength++] = c;
+    }
+  }
+}
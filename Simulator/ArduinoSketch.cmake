@@ -0,0 +1,62 @@
+# Compiles an unmodified sketch the way the Arduino builder does: prototypes for every function
+# are inserted before the first function definition, so functions can be used before they are
+# defined. Each sketch goes into its own namespace so the MKR and ESP32 sketches link together.
+#
+# Included from CMakeLists.txt it provides arduino_sketch(); run with -P it generates one sketch.
+
+if(CMAKE_SCRIPT_MODE_FILE)
+  file(READ "${SKETCH}" source)
+
+  # Top level function definitions, one per line: "type name(args) {"
+  string(REGEX MATCHALL "\n[A-Za-z_][A-Za-z0-9_ *&:<>]*[ *&][A-Za-z_][A-Za-z0-9_]*\\([^\n;{}=]*(=[^\n;{}]*)?\\)[ ]*{"
+         definitions "${source}")
+  if(NOT definitions)
+    message(FATAL_ERROR "No function definitions found in ${SKETCH}")
+  endif()
+
+  set(prototypes "")
+  foreach(definition IN LISTS definitions)
+    string(STRIP "${definition}" prototype)
+    string(REGEX REPLACE "\\)[ ]*{$" ")" prototype "${prototype}")
+    string(REGEX REPLACE "[ ]*=[^,)]*" "" prototype "${prototype}")  # Default arguments stay on the definition
+    string(APPEND prototypes "${prototype};\n")
+  endforeach()
+
+  # Split at the first definition and keep the line numbers of the sketch for diagnostics
+  list(GET definitions 0 first)
+  string(FIND "${source}" "${first}" split)
+  math(EXPR split "${split} + 1")
+  string(SUBSTRING "${source}" 0 ${split} head)
+  string(SUBSTRING "${source}" ${split} -1 tail)
+  string(REGEX MATCHALL "\n" newlines "${head}")
+  list(LENGTH newlines line)
+  math(EXPR line "${line} + 1")
+
+  file(WRITE "${OUTPUT}"
+    "// Generated from ${SKETCH}, do not edit\n"
+    "#include \"sketch_prelude.h\"\n"
+    "namespace ${NAMESPACE} {\n"
+    "#line 1 \"${SKETCH}\"\n"
+    "${head}"
+    "${prototypes}"
+    "#line ${line} \"${SKETCH}\"\n"
+    "${tail}"
+    "}  // namespace ${NAMESPACE}\n")
+  return()
+endif()
+
+set(ARDUINO_SKETCH_SCRIPT "${CMAKE_CURRENT_LIST_FILE}")
+
+# arduino_sketch(<output variable> <sketch> <namespace>): the generated source for the sketch
+function(arduino_sketch output sketch namespace)
+  get_filename_component(name "${sketch}" NAME_WE)
+  set(generated "${CMAKE_CURRENT_BINARY_DIR}/${name}_sketch.cpp")
+  add_custom_command(
+    OUTPUT "${generated}"
+    COMMAND "${CMAKE_COMMAND}" -DSKETCH=${sketch} -DNAMESPACE=${namespace} -DOUTPUT=${generated}
+            -P "${ARDUINO_SKETCH_SCRIPT}"
+    DEPENDS "${sketch}" "${ARDUINO_SKETCH_SCRIPT}"
+    COMMENT "Adding Arduino prototypes to ${name}"
+    VERBATIM)
+  set(${output} "${generated}" PARENT_SCOPE)
+endfunction()
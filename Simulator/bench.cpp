@@ -0,0 +1,388 @@
+// Gesture benchmark: both sketches run unmodified against the scripted pad, the command bus, the
+// stream link and a recording BLE host. Each corpus entry is scored on the bus commands the MKR
+// sends and on the keystrokes the ESP32 reports, with the latency from the first contact packet.
+//
+// Usage: touchbelt_bench [-v]   (-v prints both boards' Serial output)
+// Exits with 1 when a BENCH_* threshold is missed, so ctest runs it as the regression gate.
+
+#include <BleComboKeyboard.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "ble_host.h"
+#include "corpus.h"
+#include "hid_recorder.h"
+#include "touchbelt.h"
+
+// Regression thresholds, a run below any of them reports BENCH FAIL. Every corpus entry must be
+// correct: with one or two entries per class, any slack lets a whole gesture class disappear.
+const uint16_t BENCH_MAX_WRONG = 0;                 // Gestures scored WRONG
+const float BENCH_MAX_FALSE_POSITIVE_RATE = 0.02f;  // Spurious commands / all gestures
+const unsigned long BENCH_MAX_MEAN_LATENCY_MS = 350;      // First contact packet to bus command
+const unsigned long BENCH_MAX_MEAN_HID_LATENCY_MS = 400;  // First contact packet to HID report
+const unsigned long BENCH_MAX_RECOVERY_MS = 1000;         // Pad back in absolute mode after a reset
+const unsigned long BENCH_MAX_RECONNECT_MS = 1000;        // Boot to the bonded phone connected
+const float BENCH_MIN_REPEAT_RATE = 5.0f;                 // Swipe and hold: commands/s on the bus (MKR acceleration)
+const float BENCH_MIN_KEY_REPEAT_RATE = 4.0f;             // ... and keystrokes/s at the host (after BLE pacing)
+const uint64_t BENCH_REPORT_GAP_SLACK_US = 1000;          // Mouse reports are paced in whole ms (millis())
+
+const uint8_t SIM_MIN_REPEATS = 6;  // Swipe and hold entries must repeat their command at least this often
+
+// Confusion matrix classes: the bus value itself (bank 0 below CMD_EXTENDED, extended commands
+// up to the last one), then one class for extended values the ESP32 does not know
+const uint8_t SIM_CLASS_UNKNOWN = CMD_EXTENDED + EXT_LAST + 1;
+const uint8_t SIM_CLASSES = SIM_CLASS_UNKNOWN + 1;
+
+const uint64_t RUN_TAIL_US = 1000000;      // Keep both boards running after the script
+const uint64_t RUN_LIMIT_US = 600000000;  // A stalled script fails the run
+
+// Modifier bits of a recorded keystroke (bit n is key 0x80 + n)
+const uint8_t MOD_CTRL = 1 << (KEY_LEFT_CTRL - 0x80);
+const uint8_t MOD_ALT = 1 << (KEY_LEFT_ALT - 0x80);
+const uint8_t MOD_GUI = 1 << (KEY_LEFT_GUI - 0x80);
+const uint8_t MOD_VO = MOD_CTRL | MOD_ALT;
+
+// Function to find the keystroke the ESP32 sends for a bus command with its default key map
+bool expectedKeystroke(uint8_t cmd, uint8_t &modifiers, uint8_t &key) {
+  if (!(cmd & CMD_EXTENDED)) {
+    uint8_t fingerIndex = (cmd >> 3) & 0b11;
+    uint8_t eventCode = cmd & 0b111;
+    if ((eventCode < DOUBLE_CLICK) || (eventCode > SINGLE_CLICK)) {
+      return false;
+    }
+    modifiers = MOD_VO;
+    key = 'a' + fingerIndex * 6 + (eventCode - 1);
+    return true;
+  }
+
+  switch (cmd & 0b11111) {
+    case EXT_ROTOR_NEXT:
+      modifiers = MOD_VO | MOD_GUI;
+      key = KEY_RIGHT_ARROW;
+      return true;
+    case EXT_ROTOR_PREV:
+      modifiers = MOD_VO | MOD_GUI;
+      key = KEY_LEFT_ARROW;
+      return true;
+    case EXT_SCRUB:
+      modifiers = 0;
+      key = KEY_ESC;
+      return true;
+    case EXT_HOME:
+      modifiers = MOD_GUI;
+      key = 'h';
+      return true;
+    case EXT_APP_SWITCHER:
+      modifiers = MOD_GUI;
+      key = KEY_UP_ARROW;
+      return true;
+    case EXT_CONTROL_CENTER:
+      modifiers = MOD_GUI;
+      key = 'c';
+      return true;
+    case EXT_ROTOR_UP:
+      return expectedKeystroke((0 << 3) | MOVE_UP, modifiers, key);
+    case EXT_ROTOR_DOWN:
+      return expectedKeystroke((0 << 3) | MOVE_DOWN, modifiers, key);
+  }
+  return false;
+}
+
+// Function to check that streamed totals (a, b) follow the expected travel (ta, tb): the larger
+// travel axis must move the right way, the other axis at most a quarter of that
+bool followsTravel(int32_t a, int32_t b, int32_t ta, int32_t tb) {
+  bool alongA = abs(ta) >= abs(tb);
+  int32_t main = alongA ? a : b;
+  int32_t cross = alongA ? b : a;
+  int32_t travel = alongA ? ta : tb;
+  return (main != 0) && ((main > 0) == (travel > 0)) && (abs(cross) * 4 <= abs(main));
+}
+
+// Function to check the mouse reports of one entry against its expected stream output
+bool streamCorrect(const SimGesture &g, uint16_t reports, int32_t x, int32_t y, int32_t wheel, int32_t hWheel) {
+  switch (g.expectedStream) {
+    case SIM_STREAM_POINTER:
+      return (wheel == 0) && (hWheel == 0) && followsTravel(x, y, g.dy, g.dx);
+    case SIM_STREAM_SCROLL:
+      return (x == 0) && (y == 0) && followsTravel(wheel, hWheel, g.dx, -g.dy);
+  }
+  return reports == 0;
+}
+
+uint8_t simClassOf(uint8_t cmd) {
+  return (cmd < SIM_CLASS_UNKNOWN) ? cmd : SIM_CLASS_UNKNOWN;
+}
+
+void printClass(uint8_t cls) {
+  if (cls == CMD_NONE) {
+    printf("none");
+  } else if (cls == SIM_CLASS_UNKNOWN) {
+    printf("unknown");
+  } else if (cls & CMD_EXTENDED) {
+    printf("ext%d", cls & 0b11111);
+  } else {
+    printf("%df/%d", (cls >> 3) + 1, cls & 0b111);
+  }
+}
+
+int main(int argc, char **argv) {
+  bool verbose = (argc > 1) && (strcmp(argv[1], "-v") == 0);
+
+  SynapticsPad pad;
+  CommandBus bus;
+  UartLink link;
+  MkrBoard mkr(pad, bus, link);
+  Esp32Board esp32(bus, link);
+  mkr.setVerbose(verbose);
+  esp32.setVerbose(verbose);
+
+  // The phone bonded on slot 1 before: the ESP32 must find it again through directed advertising
+  storeBondedPhone();
+
+  mkr.runSetup();
+  esp32.runSetup();
+
+  // Run whichever board is behind; information only flows from the MKR to the ESP32, which reads
+  // the bus and the link at its own time
+  uint64_t endUs = 0;
+  while ((endUs == 0) || (mkr.now() < endUs) || (esp32.now() < endUs)) {
+    if (mkr.now() <= esp32.now()) {
+      mkr.runLoop();
+    } else {
+      esp32.runLoop();
+    }
+    if ((endUs == 0) && pad.scriptDone()) {
+      endUs = mkr.now() + RUN_TAIL_US;
+    }
+    if ((endUs == 0) && (mkr.now() > RUN_LIMIT_US)) {
+      printf("BENCH FAIL: script stalled at gesture %zu\n", pad.windows().size());
+      return 1;
+    }
+  }
+
+  // Score every corpus entry on the commands and keystrokes inside its window
+  const std::vector<CommandBus::Command> &commands = bus.commands();
+  const std::vector<HidRecorder::Keystroke> &keystrokes = hidRecorder.keystrokes();
+  const std::vector<HidRecorder::Move> &moves = hidRecorder.moves();
+  uint16_t correctCount = 0;
+  uint16_t spurious = 0;
+  uint16_t latencyCount = 0;
+  uint64_t latencySumUs = 0;
+  uint64_t latencyMaxUs = 0;
+  uint64_t hidLatencySumUs = 0;
+  uint64_t hidLatencyMaxUs = 0;
+  uint32_t repeatCount = 0;
+  uint64_t repeatSpanUs = 0;
+  uint32_t keyRepeatCount = 0;
+  uint64_t keyRepeatSpanUs = 0;
+  static uint16_t confusion[SIM_CLASSES][SIM_CLASSES];
+  static uint16_t classCorrect[SIM_CLASSES];  // Correct entries per expected class
+
+  for (uint8_t i = 0; i < SIM_SCRIPT_LENGTH; i++) {
+    const SimGesture &g = simScript[i];
+    const SynapticsPad::Window &window = pad.windows()[i];
+    bool repeats = (g.shape == SIM_SWIPE_HOLD);
+
+    uint8_t got = CMD_NONE;
+    uint16_t emitted = 0;
+    uint16_t mixed = 0;  // Commands that differ from the first one
+    uint64_t firstCmdUs = 0, lastCmdUs = 0;
+    for (const CommandBus::Command &command : commands) {
+      if ((command.us < window.startUs) || (command.us >= window.endUs)) {
+        continue;
+      }
+      if (emitted == 0) {
+        got = command.cmd;
+        firstCmdUs = command.us;
+      } else if (command.cmd != got) {
+        mixed++;
+      }
+      lastCmdUs = command.us;
+      emitted++;
+    }
+
+    // Every command must reach the host as its keystroke
+    uint8_t modifiers = 0, key = 0;
+    bool keyKnown = expectedKeystroke(g.expectedCmd, modifiers, key);
+    uint16_t typed = 0;
+    uint16_t wrongKeys = 0;
+    uint64_t firstKeyUs = 0, lastKeyUs = 0;
+    for (const HidRecorder::Keystroke &keystroke : keystrokes) {
+      if ((keystroke.us < window.startUs) || (keystroke.us >= window.endUs)) {
+        continue;
+      }
+      if (typed == 0) {
+        firstKeyUs = keystroke.us;
+      }
+      if (!keyKnown || (keystroke.modifiers != modifiers) || (keystroke.key != key)) {
+        wrongKeys++;
+      }
+      lastKeyUs = keystroke.us;
+      typed++;
+    }
+
+    // Stream mode: mouse reports only where expected, moving along the swipe
+    uint16_t reports = 0;
+    int32_t moveX = 0, moveY = 0, moveWheel = 0, moveHWheel = 0;
+    for (const HidRecorder::Move &move : moves) {
+      if ((move.us < window.startUs) || (move.us >= window.endUs)) {
+        continue;
+      }
+      moveX += move.x;
+      moveY += move.y;
+      moveWheel += move.wheel;
+      moveHWheel += move.hWheel;
+      reports++;
+    }
+    bool streamOk = streamCorrect(g, reports, moveX, moveY, moveWheel, moveHWheel);
+
+    bool busCorrect = (got == g.expectedCmd) && (repeats ? (emitted >= SIM_MIN_REPEATS) && (mixed == 0) : (emitted <= 1));
+    bool hidCorrect = (wrongKeys == 0) && (repeats ? (typed >= SIM_MIN_REPEATS) : (typed == emitted));
+    bool correct = busCorrect && hidCorrect && streamOk;
+    confusion[simClassOf(g.expectedCmd)][simClassOf(got)]++;
+
+    // Anything emitted beyond the one expected command is a false positive (holds may repeat it)
+    uint16_t allowed = (g.expectedCmd == CMD_NONE) ? 0 : (repeats ? emitted - mixed : 1);
+    if (emitted > allowed) {
+      spurious += emitted - allowed;
+    }
+
+    if (correct) {
+      correctCount++;
+      classCorrect[simClassOf(g.expectedCmd)]++;
+    }
+    if (correct && repeats) {
+      repeatCount += emitted - 1;
+      repeatSpanUs += lastCmdUs - firstCmdUs;
+      keyRepeatCount += typed - 1;
+      keyRepeatSpanUs += lastKeyUs - firstKeyUs;
+    }
+
+    // The first command of a hold waits for the hold on purpose, it does not count as latency
+    uint64_t latencyUs = emitted ? firstCmdUs - window.firstContactUs : 0;
+    uint64_t hidLatencyUs = typed ? firstKeyUs - window.firstContactUs : 0;
+    if (correct && !repeats && (g.expectedCmd != CMD_NONE)) {
+      latencyCount++;
+      latencySumUs += latencyUs;
+      latencyMaxUs = std::max(latencyMaxUs, latencyUs);
+      hidLatencySumUs += hidLatencyUs;
+      hidLatencyMaxUs = std::max(hidLatencyMaxUs, hidLatencyUs);
+    }
+
+    printf("SIM gesture %u: expected %u, got %u (%u cmds, %u keys) after %lu ms, HID %lu ms", i, g.expectedCmd, got, emitted,
+           typed, (unsigned long)(latencyUs / 1000), (unsigned long)(hidLatencyUs / 1000));
+    if ((g.expectedStream != SIM_STREAM_NONE) || (reports > 0)) {
+      printf(", %u mouse reports (pointer %d,%d wheel %d,%d)", reports, moveX, moveY, moveWheel, moveHWheel);
+    }
+    printf(", %s\n", correct ? "OK" : "WRONG");
+  }
+
+  float accuracy = (float)correctCount / SIM_SCRIPT_LENGTH;
+  float falsePositiveRate = (float)spurious / SIM_SCRIPT_LENGTH;
+  unsigned long meanLatencyMs = latencyCount ? latencySumUs / latencyCount / 1000 : 0;
+  unsigned long meanHidLatencyMs = latencyCount ? hidLatencySumUs / latencyCount / 1000 : 0;
+  unsigned long recoveryMaxMs = pad.recoveryMaxUs() / 1000;
+  float repeatRate = repeatSpanUs ? repeatCount * 1e6f / repeatSpanUs : 0.0f;
+  float keyRepeatRate = keyRepeatSpanUs ? keyRepeatCount * 1e6f / keyRepeatSpanUs : 0.0f;
+
+  // Confusion matrix, one row per expected class: expected -> got x count
+  printf("BENCH confusion (expected -> got x count):\n");
+  for (uint8_t expected = 0; expected < SIM_CLASSES; expected++) {
+    bool rowStarted = false;
+    for (uint8_t got = 0; got < SIM_CLASSES; got++) {
+      if (confusion[expected][got] == 0) {
+        continue;
+      }
+      if (!rowStarted) {
+        printf("  ");
+        printClass(expected);
+        printf(" ->");
+        rowStarted = true;
+      }
+      printf(" ");
+      printClass(got);
+      printf(" x%u", confusion[expected][got]);
+    }
+    if (rowStarted) {
+      printf("\n");
+    }
+  }
+
+  printf("BENCH accuracy %.3f (%u/%u), false positive rate %.3f\n", accuracy, correctCount, SIM_SCRIPT_LENGTH, falsePositiveRate);
+  printf("BENCH latency from first contact packet: bus command mean %lu ms, max %lu ms; HID report mean %lu ms, max %lu ms\n",
+         meanLatencyMs, (unsigned long)(latencyMaxUs / 1000), meanHidLatencyMs, (unsigned long)(hidLatencyMaxUs / 1000));
+  printf("BENCH hold-to-repeat %.1f commands/s, %.1f keystrokes/s\n", repeatRate, keyRepeatRate);
+  printf("BENCH pad recoveries %u/%u, recovery max %lu ms, packets dropped %u\n", pad.recovered(), pad.resets(), recoveryMaxMs,
+         pad.droppedPackets());
+  unsigned long reconnectMs = bleHost.connectedUs() / 1000;
+  if (bleHost.connected()) {
+    printf("BENCH bonded phone reconnected %lu ms after boot through %s advertising\n", reconnectMs,
+           bleHost.connectedDirected() ? "directed" : "undirected");
+  } else {
+    printf("BENCH bonded phone not reconnected\n");
+  }
+  // At most one mouse report per connection interval
+  uint64_t minReportGapUs = 0;
+  for (size_t i = 1; i < moves.size(); i++) {
+    uint64_t gapUs = moves[i].us - moves[i - 1].us;
+    if ((i == 1) || (gapUs < minReportGapUs)) {
+      minReportGapUs = gapUs;
+    }
+  }
+  printf("BENCH stream link %u bytes, %zu HID mouse reports, shortest gap %.1f ms (connection interval %.1f ms)\n",
+         link.bytesSent(), moves.size(), minReportGapUs / 1000.0, BleHost::CONN_INTERVAL_US / 1000.0);
+
+  // Accuracy and false positives guard latency tuning
+  bool pass = true;
+  if (SIM_SCRIPT_LENGTH - correctCount > BENCH_MAX_WRONG) {
+    printf("BENCH FAIL: %u gestures wrong\n", SIM_SCRIPT_LENGTH - correctCount);
+    pass = false;
+  }
+  for (uint8_t cls = 0; cls < SIM_CLASSES; cls++) {
+    uint16_t entries = 0;
+    for (uint8_t got = 0; got < SIM_CLASSES; got++) {
+      entries += confusion[cls][got];
+    }
+    if ((entries > 0) && (classCorrect[cls] == 0)) {
+      printf("BENCH FAIL: no correct ");
+      printClass(cls);
+      printf(" gesture left\n");
+      pass = false;
+    }
+  }
+  if (falsePositiveRate > BENCH_MAX_FALSE_POSITIVE_RATE) {
+    printf("BENCH FAIL: false positive rate above threshold\n");
+    pass = false;
+  }
+  if (meanLatencyMs > BENCH_MAX_MEAN_LATENCY_MS) {
+    printf("BENCH FAIL: mean bus command latency above threshold\n");
+    pass = false;
+  }
+  if (meanHidLatencyMs > BENCH_MAX_MEAN_HID_LATENCY_MS) {
+    printf("BENCH FAIL: mean HID report latency above threshold\n");
+    pass = false;
+  }
+  if ((repeatRate < BENCH_MIN_REPEAT_RATE) || (keyRepeatRate < BENCH_MIN_KEY_REPEAT_RATE)) {
+    printf("BENCH FAIL: hold-to-repeat rate below threshold\n");
+    pass = false;
+  }
+  if ((pad.recovered() < pad.resets()) || (recoveryMaxMs > BENCH_MAX_RECOVERY_MS)) {
+    printf("BENCH FAIL: pad not recovered in time\n");
+    pass = false;
+  }
+  if ((moves.size() > 1) && (minReportGapUs + BENCH_REPORT_GAP_SLACK_US < BleHost::CONN_INTERVAL_US)) {
+    printf("BENCH FAIL: more than one mouse report per connection interval\n");
+    pass = false;
+  }
+  if (!bleHost.connected() || !bleHost.connectedDirected() || (reconnectMs > BENCH_MAX_RECONNECT_MS)) {
+    printf("BENCH FAIL: bonded phone not reconnected in time through directed advertising\n");
+    pass = false;
+  }
+  if (!pass) {
+    return 1;
+  }
+  printf("BENCH PASS\n");
+  return 0;
+}
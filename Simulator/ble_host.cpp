@@ -0,0 +1,154 @@
+#include "ble_host.h"
+
+// ESP32 side
+const uint64_t STACK_INIT_US = 450000;      // BLEDevice::init and the HID service setup in the library task
+const uint64_t DIRECTED_EVENT_US = 3750;    // High duty directed advertising: an event every 3.75 ms at most
+const uint64_t DIRECTED_LIMIT_US = 1280000; // ... for 1.28 s, then the controller stops it
+const uint64_t ADV_DELAY_MAX_US = 10000;    // Random delay added to every undirected event (advDelay)
+const uint16_t LIBRARY_ADV_MIN = 0x20;      // BLEAdvertising default interval, 0.625 ms units
+const uint16_t LIBRARY_ADV_MAX = 0x40;
+
+// Phone side: a 30 ms scan window every 300 ms while it looks for a bonded accessory
+const uint64_t SCAN_INTERVAL_US = 300000;
+const uint64_t SCAN_WINDOW_US = 30000;
+const uint64_t CONNECT_US = 2500;           // CONNECT_IND to the first connection event
+const uint64_t ENCRYPT_US = 60000;          // Link encrypted with the stored keys (auth complete)
+const uint16_t CONN_INTERVAL = 24;          // 30 ms, 1.25 ms units
+const uint16_t CONN_TIMEOUT = 72;           // 720 ms, 10 ms units
+const uint32_t ADV_EVENT_LIMIT = 100000;
+
+const uint8_t BleHost::PHONE_ADDR[6] = { 0x5C, 0xF7, 0xE6, 0x12, 0x34, 0x56 };
+
+const uint64_t BleHost::CONN_INTERVAL_US = CONN_INTERVAL * 1250;
+
+BleHost bleHost;
+
+void BleHost::begin(uint64_t us) {
+  begun_ = true;
+  stackUpUs_ = us + STACK_INIT_US;
+}
+
+// Function to move the stack and the phone up to us and deliver the GAP events due by then
+void BleHost::update(uint64_t us) {
+  if (begun_ && !stackUp_ && (us >= stackUpUs_)) {
+    stackUp_ = true;
+    libraryAdvertising(stackUpUs_, true, LIBRARY_ADV_MIN, LIBRARY_ADV_MAX);
+  }
+
+  if (!connected_ && (advertising_ != ADV_OFF) && (connectUs_ != 0) && (us >= connectUs_)) {
+    connect(connectUs_);
+  } else if ((advertising_ == ADV_DIRECTED) && (us >= advertisingEndUs_)) {
+    advertising_ = ADV_OFF;
+  }
+
+  while (!gattsEvents_.empty() && (gattsEvents_.front().us <= us)) {
+    GattsEvent gattsEvent = gattsEvents_.front();
+    gattsEvents_.pop_front();
+    if (gattsHandler_) {
+      gattsHandler_(gattsEvent.event, 0, &gattsEvent.param);
+    }
+  }
+  while (!gapEvents_.empty() && (gapEvents_.front().us <= us)) {
+    GapEvent gapEvent = gapEvents_.front();
+    gapEvents_.pop_front();
+    if (gapHandler_) {
+      gapHandler_(gapEvent.event, &gapEvent.param);
+    }
+  }
+}
+
+esp_err_t BleHost::startAdvertising(uint64_t us, const esp_ble_adv_params_t &params) {
+  if (!stackUp_) {
+    return ESP_ERR_INVALID_STATE;  // Bluedroid not enabled yet
+  }
+
+  if ((params.adv_type == ADV_TYPE_DIRECT_IND_HIGH) || (params.adv_type == ADV_TYPE_DIRECT_IND_LOW)) {
+    bool toPhone = (memcmp(params.peer_addr, PHONE_ADDR, sizeof(PHONE_ADDR)) == 0);
+    advertise(us, ADV_DIRECTED, toPhone ? DIRECTED_EVENT_US : 0);
+  } else {
+    advertise(us, ADV_UNDIRECTED, (uint64_t)(params.adv_int_min + params.adv_int_max) * 625 / 2);
+  }
+
+  esp_ble_gap_cb_param_t param = {};
+  param.adv_start_cmpl.status = ESP_BT_STATUS_SUCCESS;
+  queueGap(us, ESP_GAP_BLE_ADV_START_COMPLETE_EVT, param);
+  return ESP_OK;
+}
+
+esp_err_t BleHost::stopAdvertising(uint64_t us) {
+  if (!stackUp_) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  advertising_ = ADV_OFF;
+  connectUs_ = 0;
+  queueGap(us, ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT, {});
+  return ESP_OK;
+}
+
+// BLEAdvertising::start()/stop(): ignored (the library logs an error) until the stack is up
+void BleHost::libraryAdvertising(uint64_t us, bool on, uint16_t minInterval, uint16_t maxInterval) {
+  if (!stackUp_) {
+    return;
+  }
+  if (!on) {
+    advertising_ = ADV_OFF;
+    connectUs_ = 0;
+    return;
+  }
+  esp_ble_adv_params_t params = {};
+  params.adv_int_min = minInterval;
+  params.adv_int_max = maxInterval;
+  params.adv_type = ADV_TYPE_IND;
+  startAdvertising(us, params);
+}
+
+// Function to start advertising and find the first event the phone hears (eventUs 0: never)
+void BleHost::advertise(uint64_t us, Advertising mode, uint64_t eventUs) {
+  advertising_ = mode;
+  advertisingEndUs_ = us + DIRECTED_LIMIT_US;
+  connectUs_ = 0;
+  if (connected_ || (eventUs == 0)) {
+    return;
+  }
+
+  uint64_t t = us;
+  for (uint32_t i = 0; i < ADV_EVENT_LIMIT; i++) {
+    if ((mode == ADV_DIRECTED) && (t >= advertisingEndUs_)) {
+      return;
+    }
+    if ((t % SCAN_INTERVAL_US) < SCAN_WINDOW_US) {
+      connectUs_ = t + CONNECT_US;
+      return;
+    }
+    t += eventUs;
+    if (mode == ADV_UNDIRECTED) {
+      randomState_ = randomState_ * 1103515245UL + 12345UL;
+      t += (randomState_ >> 16) % (ADV_DELAY_MAX_US + 1);
+    }
+  }
+}
+
+void BleHost::connect(uint64_t us) {
+  connected_ = true;
+  connectedUs_ = us;
+  connectedDirected_ = (advertising_ == ADV_DIRECTED);
+  advertising_ = ADV_OFF;
+  connectUs_ = 0;
+
+  esp_ble_gatts_cb_param_t connectParam = {};
+  memcpy(connectParam.connect.remote_bda, PHONE_ADDR, sizeof(PHONE_ADDR));
+  connectParam.connect.conn_params.interval = CONN_INTERVAL;
+  connectParam.connect.conn_params.latency = 0;
+  connectParam.connect.conn_params.timeout = CONN_TIMEOUT;
+  gattsEvents_.push_back({ us, ESP_GATTS_CONNECT_EVT, connectParam });
+
+  esp_ble_gap_cb_param_t param = {};
+  memcpy(param.ble_security.auth_cmpl.bd_addr, PHONE_ADDR, sizeof(PHONE_ADDR));
+  param.ble_security.auth_cmpl.addr_type = BLE_ADDR_TYPE_PUBLIC;
+  param.ble_security.auth_cmpl.success = true;
+  queueGap(us + ENCRYPT_US, ESP_GAP_BLE_AUTH_CMPL_EVT, param);
+}
+
+void BleHost::queueGap(uint64_t us, esp_gap_ble_cb_event_t event, const esp_ble_gap_cb_param_t &param) {
+  gapEvents_.push_back({ us, event, param });
+}
@@ -0,0 +1,80 @@
+// The ESP32 BLE stack as BleComboKeyboard runs it, and the phone it is bonded with.
+//
+// begin() only starts the library's BLE task: the stack comes up STACK_INIT_US later, and then the
+// library starts undirected advertising on its own. GAP calls made before that fail like on the
+// chip. The phone looks for its bonded accessory in short scan windows and connects on the first
+// advertising event it hears, so denser advertising (high duty directed) reconnects sooner. Like
+// many phones it keeps the parameters of the connection and never sends a parameter update.
+#pragma once
+
+#include <BLEDevice.h>
+#include <esp_gap_ble_api.h>
+
+#include <cstring>
+#include <deque>
+
+class BleHost {
+ public:
+  // Library side, called from the stubs with the ESP32 time
+  void begin(uint64_t us);
+  void update(uint64_t us);
+  bool stackUp() const { return stackUp_; }
+  bool connected() const { return connected_; }
+  esp_err_t startAdvertising(uint64_t us, const esp_ble_adv_params_t &params);
+  esp_err_t stopAdvertising(uint64_t us);
+  void libraryAdvertising(uint64_t us, bool on, uint16_t minInterval, uint16_t maxInterval);
+  void setGapHandler(gap_event_handler handler) { gapHandler_ = handler; }
+  void setGattsHandler(gatts_event_handler handler) { gattsHandler_ = handler; }
+
+  // Bench side
+  static const uint8_t PHONE_ADDR[6];
+  static const uint64_t CONN_INTERVAL_US;
+  uint64_t connectedUs() const { return connectedUs_; }
+  bool connectedDirected() const { return connectedDirected_; }
+
+ private:
+  enum Advertising {
+    ADV_OFF,
+    ADV_UNDIRECTED,
+    ADV_DIRECTED
+  };
+
+  struct GapEvent {
+    uint64_t us;
+    esp_gap_ble_cb_event_t event;
+    esp_ble_gap_cb_param_t param;
+  };
+
+  void advertise(uint64_t us, Advertising mode, uint64_t intervalUs);
+  struct GattsEvent {
+    uint64_t us;
+    esp_gatts_cb_event_t event;
+    esp_ble_gatts_cb_param_t param;
+  };
+
+  void queueGap(uint64_t us, esp_gap_ble_cb_event_t event, const esp_ble_gap_cb_param_t &param);
+  void connect(uint64_t us);
+
+  bool begun_ = false;
+  bool stackUp_ = false;
+  uint64_t stackUpUs_ = 0;
+
+  Advertising advertising_ = ADV_OFF;
+  uint64_t advertisingEndUs_ = 0;  // Directed advertising stops by itself
+  uint64_t connectUs_ = 0;         // When the phone connects to the current advertising, 0 = never
+  uint32_t randomState_ = 1;
+
+  bool connected_ = false;
+  uint64_t connectedUs_ = 0;
+  bool connectedDirected_ = false;
+
+  gap_event_handler gapHandler_ = nullptr;
+  gatts_event_handler gattsHandler_ = nullptr;
+  std::deque<GapEvent> gapEvents_;
+  std::deque<GattsEvent> gattsEvents_;
+};
+
+extern BleHost bleHost;
+
+// Written to the ESP32's NVS before the run: the phone bonded on host slot 1 in an earlier session
+void storeBondedPhone();
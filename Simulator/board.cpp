@@ -0,0 +1,163 @@
+#include "board.h"
+
+static Board *runningBoard = nullptr;
+
+Board::Board(const char *name, unsigned int pinAccessUs) : pinAccessUs_(pinAccessUs), name_(name) {
+  for (uint8_t pin = 0; pin < PIN_COUNT; pin++) {
+    pinModes_[pin] = INPUT;
+  }
+}
+
+void Board::runSetup() {
+  run(&Board::sketchSetup);
+}
+
+void Board::runLoop() {
+  run(&Board::sketchLoop);
+}
+
+void Board::run(void (Board::*step)()) {
+  Board *previous = runningBoard;
+  runningBoard = this;
+  (this->*step)();
+  runningBoard = previous;
+}
+
+Board &currentBoard() {
+  if (runningBoard == nullptr) {
+    fprintf(stderr, "Arduino call outside of a running sketch\n");
+    abort();
+  }
+  return *runningBoard;
+}
+
+void Board::pinMode(uint8_t pin, uint8_t mode) {
+  advance(pinAccessUs_);
+  pinModes_[pin % PIN_COUNT] = mode;
+}
+
+void Board::digitalWrite(uint8_t pin, uint8_t value) {
+  advance(pinAccessUs_);
+  pinLevels_[pin % PIN_COUNT] = value ? HIGH : LOW;
+}
+
+// Unconnected inputs read their pull resistor (floating inputs read LOW)
+int Board::digitalRead(uint8_t pin) {
+  advance(pinAccessUs_);
+  pin %= PIN_COUNT;
+  if (pinModes_[pin] == OUTPUT) {
+    return pinLevels_[pin];
+  }
+  return (pinModes_[pin] == INPUT_PULLUP) ? HIGH : LOW;
+}
+
+bool Board::drivesLow(uint8_t pin) const {
+  return (pinModes_[pin] == OUTPUT) && (pinLevels_[pin] == LOW);
+}
+
+// Port 0 is the USB console: printed line by line with the board time when verbose
+void Board::serialWrite(uint8_t port, uint8_t data) {
+  if (port != 0) {
+    return;
+  }
+  if (data == '\r') {
+    return;
+  }
+  if (data != '\n') {
+    consoleLine_ += (char)data;
+    return;
+  }
+  if (verbose_) {
+    printf("[%-5s %10.3f ms] %s\n", name_, clockUs_ / 1000.0, consoleLine_.c_str());
+  }
+  consoleLine_.clear();
+}
+
+// ---- Arduino core ----
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+EspClass ESP;
+
+unsigned long millis() {
+  return currentBoard().now() / 1000;
+}
+
+unsigned long micros() {
+  return currentBoard().now();
+}
+
+void delay(unsigned long ms) {
+  currentBoard().advance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  currentBoard().advance(us);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  currentBoard().pinMode(pin, mode);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  currentBoard().digitalWrite(pin, value);
+}
+
+int digitalRead(uint8_t pin) {
+  return currentBoard().digitalRead(pin);
+}
+
+int HardwareSerial::available() {
+  return currentBoard().serialAvailable(port_);
+}
+
+int HardwareSerial::availableForWrite() {
+  return currentBoard().serialAvailableForWrite(port_);
+}
+
+int HardwareSerial::read() {
+  return currentBoard().serialRead(port_);
+}
+
+size_t HardwareSerial::write(uint8_t data) {
+  currentBoard().serialWrite(port_, data);
+  return 1;
+}
+
+void EspClass::restart() {
+  fprintf(stderr, "%s: ESP.restart() is not supported in the host build\n", currentBoard().name());
+  exit(2);
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    write(buffer[i]);
+  }
+  return size;
+}
+
+size_t Print::print(const char *text) {
+  return write((const uint8_t *)text, strlen(text));
+}
+
+size_t Print::print(long value, int base) {
+  if (base == HEX) {
+    return print((unsigned long)(uint32_t)value, HEX);
+  }
+  char text[24];
+  snprintf(text, sizeof(text), "%ld", value);
+  return print(text);
+}
+
+size_t Print::print(unsigned long value, int base) {
+  char text[24];
+  snprintf(text, sizeof(text), (base == HEX) ? "%lX" : "%lu", value);
+  return print(text);
+}
+
+size_t Print::print(double value, int digits) {
+  char text[48];
+  snprintf(text, sizeof(text), "%.*f", digits, value);
+  return print(text);
+}
@@ -0,0 +1,55 @@
+// Virtual boards for the host build. Each board runs one sketch with its own clock, pins and
+// serial ports; the Arduino core calls in stubs/Arduino.h act on the board that is running.
+#pragma once
+
+#include <Arduino.h>
+
+#include <string>
+
+class Board {
+ public:
+  // pinAccessUs: time one pinMode/digitalWrite/digitalRead call takes, so polling loops advance time
+  Board(const char *name, unsigned int pinAccessUs);
+  virtual ~Board() = default;
+
+  // Run the sketch's setup() or one pass of its loop() on this board
+  void runSetup();
+  void runLoop();
+
+  const char *name() const { return name_; }
+  uint64_t now() const { return clockUs_; }
+  void advance(uint64_t us) { clockUs_ += us; }
+  void setVerbose(bool verbose) { verbose_ = verbose; }
+
+  // Arduino core, dispatched here for the running board
+  virtual void pinMode(uint8_t pin, uint8_t mode);
+  virtual void digitalWrite(uint8_t pin, uint8_t value);
+  virtual int digitalRead(uint8_t pin);
+  virtual int serialAvailable(uint8_t port) { return 0; }
+  virtual int serialAvailableForWrite(uint8_t port) { return 0; }
+  virtual int serialRead(uint8_t port) { return -1; }
+  virtual void serialWrite(uint8_t port, uint8_t data);
+
+ protected:
+  virtual void sketchSetup() = 0;
+  virtual void sketchLoop() = 0;
+
+  // Pin state as set by the sketch
+  static const uint8_t PIN_COUNT = 64;
+  uint8_t pinModes_[PIN_COUNT] = {};
+  uint8_t pinLevels_[PIN_COUNT] = {};
+  bool drivesLow(uint8_t pin) const;
+
+  unsigned int pinAccessUs_;
+
+ private:
+  void run(void (Board::*step)());
+
+  const char *name_;
+  uint64_t clockUs_ = 0;
+  bool verbose_ = false;
+  std::string consoleLine_;  // Serial output, printed per line when verbose
+};
+
+// The board whose sketch is running
+Board &currentBoard();
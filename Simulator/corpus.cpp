@@ -0,0 +1,81 @@
+#include "corpus.h"
+
+const SimGesture simScript[] = {
+  // Taps, double taps and swipes for each finger count
+  { 1, SIM_TAP, 0, 0, 50, 0, (0 << 3) | SINGLE_CLICK },
+  { 1, SIM_DOUBLE_TAP, 0, 0, 50, 0, (0 << 3) | DOUBLE_CLICK },
+  { 1, SIM_SWIPE, 0, -600, 200, 0, (0 << 3) | MOVE_LEFT },
+  { 1, SIM_SWIPE, 0, 600, 200, 0, (0 << 3) | MOVE_RIGHT },
+  { 1, SIM_SWIPE, -600, 0, 200, 0, (0 << 3) | MOVE_UP },
+  { 1, SIM_SWIPE, 600, 0, 200, 0, (0 << 3) | MOVE_DOWN },
+  { 2, SIM_TAP, 0, 0, 50, 0, (1 << 3) | SINGLE_CLICK },
+  { 2, SIM_DOUBLE_TAP, 0, 0, 50, 0, (1 << 3) | DOUBLE_CLICK },
+  { 2, SIM_SWIPE, 0, -600, 200, 0, (1 << 3) | MOVE_LEFT },
+  { 2, SIM_SWIPE, 0, 600, 200, 0, (1 << 3) | MOVE_RIGHT },
+  { 2, SIM_SWIPE, -600, 0, 200, 0, (1 << 3) | MOVE_UP },
+  { 2, SIM_SWIPE, 600, 0, 200, 0, (1 << 3) | MOVE_DOWN },
+  { 3, SIM_TAP, 0, 0, 50, 0, (2 << 3) | SINGLE_CLICK },
+  { 3, SIM_DOUBLE_TAP, 0, 0, 50, 0, (2 << 3) | DOUBLE_CLICK },
+  { 3, SIM_SWIPE, 0, -600, 200, 0, (2 << 3) | MOVE_LEFT },
+  { 3, SIM_SWIPE, 0, 600, 200, 0, (2 << 3) | MOVE_RIGHT },
+  { 3, SIM_SWIPE, -600, 0, 200, 0, (2 << 3) | MOVE_UP },
+  { 3, SIM_SWIPE, 600, 0, 200, 0, (2 << 3) | MOVE_DOWN },
+  { 4, SIM_TAP, 0, 0, 50, 0, (3 << 3) | SINGLE_CLICK },
+  { 4, SIM_DOUBLE_TAP, 0, 0, 50, 0, (3 << 3) | DOUBLE_CLICK },
+  { 4, SIM_SWIPE, 0, -600, 200, 0, (3 << 3) | MOVE_LEFT },
+  { 4, SIM_SWIPE, 0, 600, 200, 0, (3 << 3) | MOVE_RIGHT },
+  { 4, SIM_SWIPE, -600, 0, 200, 0, (3 << 3) | MOVE_UP },
+  { 4, SIM_SWIPE, 600, 0, 200, 0, (3 << 3) | MOVE_DOWN },
+
+  // Jittery contacts, slow taps and short, fast swipes
+  { 1, SIM_TAP, 0, 0, 50, 20, (0 << 3) | SINGLE_CLICK },
+  { 1, SIM_TAP, 0, 0, 200, 20, (0 << 3) | SINGLE_CLICK },
+  { 1, SIM_DOUBLE_TAP, 0, 0, 60, 20, (0 << 3) | DOUBLE_CLICK },
+  { 1, SIM_SWIPE, 0, -600, 250, 20, (0 << 3) | MOVE_LEFT },
+  { 1, SIM_SWIPE, 400, 0, 100, 10, (0 << 3) | MOVE_DOWN },
+  { 2, SIM_TAP, 0, 0, 60, 20, (1 << 3) | SINGLE_CLICK },
+  { 2, SIM_SWIPE, 600, 0, 250, 20, (1 << 3) | MOVE_DOWN },
+  { 3, SIM_SWIPE, 0, 600, 250, 20, (2 << 3) | MOVE_RIGHT },
+
+  // Palms must not produce anything
+  { SIM_PALM, SIM_TAP, 0, 0, 300, 10, CMD_NONE },
+  { SIM_PALM, SIM_SWIPE, 0, 800, 300, 10, CMD_NONE },
+
+  // Shapes
+  { 1, SIM_CIRCLE, 500, 1, 700, 0, CMD_EXTENDED | EXT_ROTOR_NEXT },
+  { 1, SIM_CIRCLE, 500, -1, 700, 0, CMD_EXTENDED | EXT_ROTOR_PREV },
+  { 2, SIM_CIRCLE, 400, 1, 800, 10, CMD_EXTENDED | EXT_ROTOR_NEXT },
+  { 2, SIM_SCRUB, 300, 600, 600, 0, CMD_EXTENDED | EXT_SCRUB },
+  { 2, SIM_SCRUB, 300, 600, 600, 15, CMD_EXTENDED | EXT_SCRUB },
+
+  // Zone mode: toggled by a two-finger hold, taps on zones send their action
+  { 2, SIM_TAP, 0, 0, 1700, 0, CMD_NONE },
+  { 1, SIM_TAP, -1500, -1200, 50, 0, CMD_EXTENDED | EXT_HOME },
+  { 1, SIM_TAP, -1500, 1200, 50, 10, CMD_EXTENDED | EXT_APP_SWITCHER },
+  { 1, SIM_TAP, 0, 1200, 50, 0, CMD_EXTENDED | EXT_ROTOR_NEXT },
+  { 1, SIM_TAP, 1500, 0, 50, 0, CMD_EXTENDED | EXT_ROTOR_DOWN },
+  { 1, SIM_TAP, 0, 0, 50, 0, (0 << 3) | SINGLE_CLICK },
+  { 1, SIM_SWIPE, 0, 600, 200, 0, (0 << 3) | MOVE_RIGHT },
+  { 2, SIM_TAP, 0, 0, 1700, 0, CMD_NONE },
+
+  // Swipe then hold: the direction repeats until lift, and the lift adds nothing
+  { 1, SIM_SWIPE_HOLD, 0, 600, 2000, 0, (0 << 3) | MOVE_RIGHT },
+  { 1, SIM_SWIPE_HOLD, 0, -600, 2000, 10, (0 << 3) | MOVE_LEFT },
+  { 2, SIM_SWIPE_HOLD, 600, 0, 2000, 10, (1 << 3) | MOVE_DOWN },
+
+  // Pad resets: brown-out, lost announcement, relative packets, unplugged for a second
+  { 0, SIM_PAD_RESET, SIM_RESET_ANNOUNCED, 0, 0, 0, CMD_NONE },
+  { 1, SIM_SWIPE, 0, -600, 200, 0, (0 << 3) | MOVE_LEFT },
+  { 0, SIM_PAD_RESET, SIM_RESET_LOST, 0, 0, 0, CMD_NONE },
+  { 0, SIM_PAD_RESET, SIM_RESET_RELATIVE, 0, 0, 0, CMD_NONE },
+  { 0, SIM_PAD_RESET, SIM_RESET_ANNOUNCED, 0, 1000, 0, CMD_NONE },
+  { 2, SIM_SWIPE, 0, 600, 250, 10, (1 << 3) | MOVE_RIGHT },
+
+  // Stream mode: toggled by a three-finger hold, movement is streamed, taps still work
+  { 3, SIM_TAP, 0, 0, 1700, 0, CMD_NONE },
+  { 1, SIM_SWIPE, 0, 600, 200, 0, CMD_NONE, SIM_STREAM_POINTER },
+  { 2, SIM_SWIPE, 600, 0, 300, 10, CMD_NONE, SIM_STREAM_SCROLL },
+  { 1, SIM_TAP, 0, 0, 50, 0, (0 << 3) | SINGLE_CLICK },
+  { 3, SIM_TAP, 0, 0, 1700, 0, CMD_NONE },
+};
+const uint8_t SIM_SCRIPT_LENGTH = sizeof(simScript) / sizeof(simScript[0]);
@@ -0,0 +1,60 @@
+// Labelled gesture corpus played by the scripted pad, with the bus command each entry must produce
+#pragma once
+
+#include <stdint.h>
+
+// Command bus protocol, as decoded by the ESP32 (bits 4-3 finger index, bits 2-0 event)
+const uint8_t CMD_NONE = 0b000000;
+const uint8_t DOUBLE_CLICK = 0b001;
+const uint8_t MOVE_LEFT = 0b010;
+const uint8_t MOVE_RIGHT = 0b011;
+const uint8_t MOVE_UP = 0b100;
+const uint8_t MOVE_DOWN = 0b101;
+const uint8_t SINGLE_CLICK = 0b110;
+
+// Bit 5 selects the extended command bank, bits 4-0 then hold an extended command
+const uint8_t CMD_EXTENDED = 0b100000;
+const uint8_t EXT_ROTOR_NEXT = 0b00001;
+const uint8_t EXT_ROTOR_PREV = 0b00010;
+const uint8_t EXT_SCRUB = 0b00011;
+const uint8_t EXT_HOME = 0b00100;
+const uint8_t EXT_APP_SWITCHER = 0b00101;
+const uint8_t EXT_CONTROL_CENTER = 0b00110;
+const uint8_t EXT_ROTOR_UP = 0b00111;
+const uint8_t EXT_ROTOR_DOWN = 0b01000;
+const uint8_t EXT_LAST = EXT_ROTOR_DOWN;  // Highest extended command, keep it in step with new ones
+
+// Gesture shapes
+const uint8_t SIM_TAP = 0;
+const uint8_t SIM_DOUBLE_TAP = 1;
+const uint8_t SIM_SWIPE = 2;
+const uint8_t SIM_CIRCLE = 3;
+const uint8_t SIM_SCRUB = 4;
+const uint8_t SIM_PAD_RESET = 5;   // Not a gesture: the pad resets (see SimGesture)
+const uint8_t SIM_SWIPE_HOLD = 6;  // Swipe in SIM_HOLD_SWIPE_MS, then hold until durationMs
+
+// Pad reset variants (dx of a SIM_PAD_RESET entry)
+const int16_t SIM_RESET_ANNOUNCED = 0;  // 0xAA 0x00 reaches the host
+const int16_t SIM_RESET_LOST = 1;       // The announcement is lost, the pad goes quiet
+const int16_t SIM_RESET_RELATIVE = 2;   // The announcement is lost and relative packets stream
+
+const uint8_t SIM_PALM = 5;  // Finger count value for a palm contact (wide W)
+
+// Stream mode output expected from an entry: mouse reports along the entry's dx/dy travel
+const uint8_t SIM_STREAM_NONE = 0;     // No mouse report at all
+const uint8_t SIM_STREAM_POINTER = 1;  // Pointer: x follows +dy (Right), y follows +dx (Down), no wheel
+const uint8_t SIM_STREAM_SCROLL = 2;   // Natural scrolling: wheel follows +dx, hWheel follows -dy, no pointer
+
+struct SimGesture {
+  uint8_t fingers;      // 0 = no contact, SIM_PALM = palm
+  uint8_t shape;
+  int16_t dx, dy;       // Raw travel (+dx is Down, +dy is Right); taps: offset from the center;
+                        // circle: dx = radius, dy > 0 clockwise; pad reset: dx = SIM_RESET_* variant
+  uint16_t durationMs;  // Contact time (per tap for double taps); pad reset: time the pad is unplugged
+  uint8_t jitter;       // Raw position noise amplitude
+  uint8_t expectedCmd;  // Command the recogniser should emit, exactly once (CMD_NONE = nothing)
+  uint8_t expectedStream = SIM_STREAM_NONE;
+};
+
+extern const SimGesture simScript[];
+extern const uint8_t SIM_SCRIPT_LENGTH;
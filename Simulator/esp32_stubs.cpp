@@ -0,0 +1,153 @@
+// ESP32 libraries for the host build: BLE HID goes to the recorder, the connection to the BLE stack
+// model, NVS lives in memory
+#include <BLEDevice.h>
+#include <BleComboKeyboard.h>
+#include <BleComboMouse.h>
+#include <Preferences.h>
+#include <esp_mac.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ble_host.h"
+#include "hid_recorder.h"
+
+HidRecorder hidRecorder;
+
+static std::map<std::string, std::vector<uint8_t>> nvs;
+
+static bool isModifier(uint8_t key) {
+  return (key >= 0x80) && (key <= 0x87);
+}
+
+void HidRecorder::press(uint64_t us, uint8_t key) {
+  if (isModifier(key)) {
+    modifiers_ |= 1 << (key - 0x80);
+  } else {
+    keystrokes_.push_back({ us, modifiers_, key });
+  }
+}
+
+void HidRecorder::release(uint64_t us, uint8_t key) {
+  if (isModifier(key)) {
+    modifiers_ &= ~(1 << (key - 0x80));
+  }
+}
+
+void HidRecorder::write(uint64_t us, uint8_t key) {
+  keystrokes_.push_back({ us, modifiers_, key });
+}
+
+// Like the library: begin() only starts the BLE task, the stack and the connection come later
+void BleComboKeyboard::begin() {
+  bleHost.begin(micros());
+}
+
+bool BleComboKeyboard::isConnected() {
+  bleHost.update(micros());
+  return bleHost.connected();
+}
+
+size_t BleComboKeyboard::press(uint8_t key) {
+  hidRecorder.press(micros(), key);
+  return 1;
+}
+
+size_t BleComboKeyboard::release(uint8_t key) {
+  hidRecorder.release(micros(), key);
+  return 1;
+}
+
+size_t BleComboKeyboard::write(uint8_t key) {
+  hidRecorder.write(micros(), key);
+  return 1;
+}
+
+void BleComboKeyboard::releaseAll() {
+  hidRecorder.releaseAll(micros());
+}
+
+void BleComboMouse::move(signed char x, signed char y, signed char wheel, signed char hWheel) {
+  hidRecorder.move(micros(), x, y, wheel, hWheel);
+}
+
+uint8_t Preferences::getUChar(const char *key, uint8_t defaultValue) {
+  auto entry = nvs.find(key);
+  return ((entry == nvs.end()) || entry->second.empty()) ? defaultValue : entry->second[0];
+}
+
+size_t Preferences::putUChar(const char *key, uint8_t value) {
+  return putBytes(key, &value, 1);
+}
+
+size_t Preferences::getBytes(const char *key, void *buffer, size_t length) {
+  auto entry = nvs.find(key);
+  if ((entry == nvs.end()) || (entry->second.size() > length)) {
+    return 0;
+  }
+  memcpy(buffer, entry->second.data(), entry->second.size());
+  return entry->second.size();
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t length) {
+  const uint8_t *bytes = (const uint8_t *)value;
+  nvs[key].assign(bytes, bytes + length);
+  return length;
+}
+
+// The sketch's HostPeer record for slot 1: valid, address type, address
+void storeBondedPhone() {
+  uint8_t peer[8] = { 1, BLE_ADDR_TYPE_PUBLIC };
+  memcpy(&peer[2], BleHost::PHONE_ADDR, sizeof(BleHost::PHONE_ADDR));
+  nvs["peer0"].assign(peer, peer + sizeof(peer));
+}
+
+void BLEAdvertising::start() {
+  bleHost.libraryAdvertising(micros(), true, minInterval_, maxInterval_);
+}
+
+void BLEAdvertising::stop() {
+  bleHost.libraryAdvertising(micros(), false, 0, 0);
+}
+
+void BLEDevice::setCustomGapHandler(gap_event_handler handler) {
+  bleHost.setGapHandler(handler);
+}
+
+void BLEDevice::setCustomGattsHandler(gatts_event_handler handler) {
+  bleHost.setGattsHandler(handler);
+}
+
+BLEAdvertising *BLEDevice::getAdvertising() {
+  static BLEAdvertising advertising;
+  return &advertising;
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+  switch (code) {
+    case ESP_OK:
+      return "ESP_OK";
+    case ESP_ERR_INVALID_STATE:
+      return "ESP_ERR_INVALID_STATE";
+  }
+  return "ESP_FAIL";
+}
+
+esp_err_t esp_ble_gap_start_advertising(esp_ble_adv_params_t *params) {
+  return bleHost.startAdvertising(micros(), *params);
+}
+
+esp_err_t esp_ble_gap_stop_advertising() {
+  return bleHost.stopAdvertising(micros());
+}
+
+esp_err_t esp_efuse_mac_get_default(uint8_t *mac) {
+  const uint8_t factoryMac[6] = { 0x24, 0x0A, 0xC4, 0x00, 0x00, 0x10 };
+  memcpy(mac, factoryMac, sizeof(factoryMac));
+  return ESP_OK;
+}
+
+esp_err_t esp_base_mac_addr_set(const uint8_t *mac) {
+  return ESP_OK;
+}
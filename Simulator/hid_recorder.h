@@ -0,0 +1,36 @@
+// HID reports the ESP32 sketch sends through BleComboKeyboard/BleComboMouse, with the ESP32 time
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+class HidRecorder {
+ public:
+  struct Keystroke {
+    uint64_t us;
+    uint8_t modifiers;  // Bit n set while modifier key 0x80 + n is pressed
+    uint8_t key;
+  };
+
+  struct Move {
+    uint64_t us;
+    int8_t x, y, wheel, hWheel;
+  };
+
+  void press(uint64_t us, uint8_t key);
+  void release(uint64_t us, uint8_t key);
+  void releaseAll(uint64_t us) { modifiers_ = 0; }
+  void write(uint64_t us, uint8_t key);
+  void move(uint64_t us, int8_t x, int8_t y, int8_t wheel, int8_t hWheel) { moves_.push_back({ us, x, y, wheel, hWheel }); }
+
+  const std::vector<Keystroke> &keystrokes() const { return keystrokes_; }
+  const std::vector<Move> &moves() const { return moves_; }
+
+ private:
+  uint8_t modifiers_ = 0;
+  std::vector<Keystroke> keystrokes_;
+  std::vector<Move> moves_;
+};
+
+extern HidRecorder hidRecorder;
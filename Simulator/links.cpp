@@ -0,0 +1,60 @@
+#include "links.h"
+
+#include <algorithm>
+
+void CommandBus::drive(uint64_t us, uint8_t bit, bool high) {
+  uint8_t value = high ? (value_ | (1 << bit)) : (value_ & ~(1 << bit));
+  if (value == value_) {
+    return;
+  }
+
+  if ((value_ != 0) && (us - valueSince_ >= SETTLED_US)) {
+    commands_.push_back({ valueSince_, value_ });
+  }
+  value_ = value;
+  valueSince_ = us;
+  changes_.push_back({ us, value });
+}
+
+bool CommandBus::read(uint64_t us, uint8_t bit) const {
+  // Last change at or before us
+  auto after = std::upper_bound(changes_.begin(), changes_.end(), us,
+                                [](uint64_t t, const Change &change) { return t < change.us; });
+  uint8_t value = (after == changes_.begin()) ? 0 : (after - 1)->value;
+  return (value >> bit) & 0x01;
+}
+
+void UartLink::send(uint64_t us, uint8_t data) {
+  lineFreeUs_ = std::max(lineFreeUs_, us) + BYTE_US;
+  inFlight_.push_back({ lineFreeUs_, data });
+  bytesSent_++;
+}
+
+int UartLink::available(uint64_t us) const {
+  int count = 0;
+  for (const Byte &byte : inFlight_) {
+    if (byte.arrivalUs > us) {
+      break;
+    }
+    count++;
+  }
+  return count;
+}
+
+int UartLink::read(uint64_t us) {
+  if (inFlight_.empty() || (inFlight_.front().arrivalUs > us)) {
+    return -1;
+  }
+  uint8_t data = inFlight_.front().data;
+  inFlight_.pop_front();
+  return data;
+}
+
+// Bytes still waiting for the line sit in the MKR transmit buffer
+int UartLink::txFree(uint64_t us) const {
+  int queued = 0;
+  for (auto byte = inFlight_.rbegin(); (byte != inFlight_.rend()) && (byte->arrivalUs - BYTE_US > us); ++byte) {
+    queued++;
+  }
+  return std::max(0, TX_BUFFER - queued);
+}
@@ -0,0 +1,58 @@
+// Wiring between the two boards. Only the MKR drives and only the ESP32 listens, so each side
+// runs at its own time: a read at time t sees what the MKR had written by then.
+#pragma once
+
+#include <stdint.h>
+
+#include <deque>
+#include <vector>
+
+// The six command wires, MKR pins 0, 1, 2, 3, 7, 8 to ESP32 pins 23, 22, 21, 19, 18, 17
+class CommandBus {
+ public:
+  struct Command {
+    uint64_t us;  // When the command appeared on the wires
+    uint8_t cmd;
+  };
+
+  void drive(uint64_t us, uint8_t bit, bool high);
+  bool read(uint64_t us, uint8_t bit) const;
+
+  // Commands the MKR sent: values held long enough to be more than the pins changing one by one
+  const std::vector<Command> &commands() const { return commands_; }
+
+ private:
+  static const uint64_t SETTLED_US = 1000;
+
+  struct Change {
+    uint64_t us;
+    uint8_t value;  // All six wires after the change
+  };
+  std::vector<Change> changes_;
+  uint8_t value_ = 0;
+  uint64_t valueSince_ = 0;
+  std::vector<Command> commands_;
+};
+
+// MKR Serial1 TX to ESP32 Serial2 RX (GPIO16) at 115200 baud
+class UartLink {
+ public:
+  void send(uint64_t us, uint8_t data);
+  int available(uint64_t us) const;
+  int read(uint64_t us);
+  int txFree(uint64_t us) const;  // Room left in the MKR transmit buffer
+
+  uint32_t bytesSent() const { return bytesSent_; }
+
+ private:
+  static const uint64_t BYTE_US = 87;  // Start, 8 data and stop bits at 115200 baud
+  static const int TX_BUFFER = 64;
+
+  struct Byte {
+    uint64_t arrivalUs;
+    uint8_t data;
+  };
+  std::deque<Byte> inFlight_;  // Sent and not read yet, oldest first
+  uint64_t lineFreeUs_ = 0;
+  uint32_t bytesSent_ = 0;
+};
@@ -0,0 +1,13 @@
+// Included ahead of each generated sketch: every library header the sketches use, so their own
+// #include lines (inside the sketch namespace) find the headers already included
+#pragma once
+
+#include <Arduino.h>
+#include <BLEDevice.h>
+#include <BleComboKeyboard.h>
+#include <BleComboMouse.h>
+#include <FlashStorage.h>
+#include <Preferences.h>
+#include <esp_gap_ble_api.h>
+#include <esp_gatts_api.h>
+#include <esp_mac.h>
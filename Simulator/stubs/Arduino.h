@@ -0,0 +1,128 @@
+// Host build: the part of the Arduino core used by the two sketches.
+// Time, pins and serial ports belong to the board that is running (see board.h).
+#pragma once
+
+#include <ctype.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <type_traits>
+
+using std::abs;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define INPUT_PULLDOWN 0x09
+
+#define DEC 10
+#define HEX 16
+
+#define PI 3.1415926535897932384626433832795
+
+#define SERIAL_8N1 0x800001c
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+template <class T, class L, class H>
+T constrain(T x, L low, H high) {
+  return (x < low) ? low : ((x > high) ? high : x);
+}
+
+template <class A, class B>
+typename std::common_type<A, B>::type min(A a, B b) {
+  return (b < a) ? b : a;
+}
+
+template <class A, class B>
+typename std::common_type<A, B>::type max(A a, B b) {
+  return (a < b) ? b : a;
+}
+
+class String {
+ public:
+  String(const char *text = "") : text_(text) {}
+  const char *c_str() const { return text_.c_str(); }
+  unsigned int length() const { return text_.size(); }
+
+ private:
+  std::string text_;
+};
+
+class Print {
+ public:
+  virtual ~Print() = default;
+  virtual size_t write(uint8_t data) = 0;
+  size_t write(const uint8_t *buffer, size_t size);
+
+  size_t print(const char *text);
+  size_t print(const String &text) { return print(text.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+  size_t print(int value, int base = DEC) { return print((long)value, base); }
+  size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+  size_t print(long value, int base = DEC);
+  size_t print(unsigned long value, int base = DEC);
+  size_t print(double value, int digits = 2);
+
+  size_t println() { return print("\r\n"); }
+  template <class T>
+  size_t println(T value) {
+    size_t n = print(value);
+    return n + println();
+  }
+  template <class T>
+  size_t println(T value, int format) {
+    size_t n = print(value, format);
+    return n + println();
+  }
+};
+
+// Serial is the USB console of the running board, Serial1 (MKR) and Serial2 (ESP32) the stream link
+class HardwareSerial : public Print {
+ public:
+  explicit HardwareSerial(uint8_t port) : port_(port) {}
+  void begin(unsigned long baud) {}
+  void begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin) {}
+  int available();
+  int availableForWrite();
+  int read();
+  void flush() {}
+  size_t write(uint8_t data) override;
+  using Print::write;
+  operator bool() const { return true; }
+
+ private:
+  uint8_t port_;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+class EspClass {
+ public:
+  void restart();
+};
+
+extern EspClass ESP;
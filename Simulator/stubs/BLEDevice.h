@@ -0,0 +1,27 @@
+// Host build: advertising, GAP and GATTS events go to the BLE stack model (see ble_host.h)
+#pragma once
+
+#include <esp_gap_ble_api.h>
+#include <esp_gatts_api.h>
+
+class BLEAdvertising {
+ public:
+  void setMinInterval(uint16_t interval) { minInterval_ = interval; }
+  void setMaxInterval(uint16_t interval) { maxInterval_ = interval; }
+  void start();
+  void stop();
+
+ private:
+  uint16_t minInterval_ = 0x20;
+  uint16_t maxInterval_ = 0x40;
+};
+
+typedef void (*gap_event_handler)(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+typedef void (*gatts_event_handler)(esp_gatts_cb_event_t event, esp_gatt_if_t gattsIf, esp_ble_gatts_cb_param_t *param);
+
+class BLEDevice {
+ public:
+  static void setCustomGapHandler(gap_event_handler handler);
+  static void setCustomGattsHandler(gatts_event_handler handler);
+  static BLEAdvertising *getAdvertising();
+};
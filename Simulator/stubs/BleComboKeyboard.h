@@ -0,0 +1,25 @@
+// Host build: a connected BLE keyboard that records every report (see hid_recorder.h)
+#pragma once
+
+#include <Arduino.h>
+
+const uint8_t KEY_LEFT_CTRL = 0x80;
+const uint8_t KEY_LEFT_SHIFT = 0x81;
+const uint8_t KEY_LEFT_ALT = 0x82;
+const uint8_t KEY_LEFT_GUI = 0x83;
+const uint8_t KEY_UP_ARROW = 0xDA;
+const uint8_t KEY_DOWN_ARROW = 0xD9;
+const uint8_t KEY_LEFT_ARROW = 0xD8;
+const uint8_t KEY_RIGHT_ARROW = 0xD7;
+const uint8_t KEY_ESC = 0xB1;
+
+class BleComboKeyboard {
+ public:
+  BleComboKeyboard(std::string deviceName = "ESP32 Keyboard/Mouse", std::string deviceManufacturer = "Espressif", uint8_t batteryLevel = 100) {}
+  void begin();
+  bool isConnected();
+  size_t press(uint8_t key);
+  size_t release(uint8_t key);
+  size_t write(uint8_t key);
+  void releaseAll();
+};
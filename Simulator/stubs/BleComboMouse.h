@@ -0,0 +1,10 @@
+// Host build: mouse reports go to the HID recorder
+#pragma once
+
+#include <BleComboKeyboard.h>
+
+class BleComboMouse {
+ public:
+  explicit BleComboMouse(BleComboKeyboard *keyboard) {}
+  void move(signed char x, signed char y, signed char wheel = 0, signed char hWheel = 0);
+};
@@ -0,0 +1,14 @@
+// Host build: flash starts erased (all defaults) on every run
+#pragma once
+
+template <class T>
+class FlashStorageClass {
+ public:
+  T read() { return value_; }
+  void write(T value) { value_ = value; }
+
+ private:
+  T value_{};
+};
+
+#define FlashStorage(name, T) FlashStorageClass<T> name
@@ -0,0 +1,15 @@
+// Host build: NVS lives in memory, empty on every run unless the bench stores a bond first
+#pragma once
+
+#include <Arduino.h>
+
+
+class Preferences {
+ public:
+  bool begin(const char *name, bool readOnly = false) { return true; }
+  void end() {}
+  uint8_t getUChar(const char *key, uint8_t defaultValue = 0);
+  size_t putUChar(const char *key, uint8_t value);
+  size_t getBytes(const char *key, void *buffer, size_t length);
+  size_t putBytes(const char *key, const void *value, size_t length);
+};
@@ -0,0 +1,97 @@
+// Host build: the GAP types and calls used for directed advertising
+#pragma once
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_STATE 0x103
+
+typedef enum {
+  ESP_BT_STATUS_SUCCESS = 0,
+  ESP_BT_STATUS_FAIL = 1,
+} esp_bt_status_t;
+
+const char *esp_err_to_name(esp_err_t code);
+
+typedef uint8_t esp_bd_addr_t[6];
+
+typedef enum {
+  BLE_ADDR_TYPE_PUBLIC = 0x00,
+  BLE_ADDR_TYPE_RANDOM = 0x01,
+  BLE_ADDR_TYPE_RPA_PUBLIC = 0x02,
+  BLE_ADDR_TYPE_RPA_RANDOM = 0x03,
+} esp_ble_addr_type_t;
+
+typedef enum {
+  ADV_TYPE_IND = 0x00,
+  ADV_TYPE_DIRECT_IND_HIGH = 0x01,
+  ADV_TYPE_SCAN_IND = 0x02,
+  ADV_TYPE_NONCONN_IND = 0x03,
+  ADV_TYPE_DIRECT_IND_LOW = 0x04,
+} esp_ble_adv_type_t;
+
+typedef enum {
+  ADV_CHNL_37 = 0x01,
+  ADV_CHNL_38 = 0x02,
+  ADV_CHNL_39 = 0x04,
+  ADV_CHNL_ALL = 0x07,
+} esp_ble_adv_channel_t;
+
+typedef enum {
+  ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY = 0x00,
+} esp_ble_adv_filter_t;
+
+typedef struct {
+  uint16_t adv_int_min;
+  uint16_t adv_int_max;
+  esp_ble_adv_type_t adv_type;
+  esp_ble_addr_type_t own_addr_type;
+  esp_bd_addr_t peer_addr;
+  esp_ble_addr_type_t peer_addr_type;
+  esp_ble_adv_channel_t channel_map;
+  esp_ble_adv_filter_t adv_filter_policy;
+} esp_ble_adv_params_t;
+
+typedef enum {
+  ESP_GAP_BLE_ADV_START_COMPLETE_EVT = 6,
+  ESP_GAP_BLE_AUTH_CMPL_EVT = 8,
+  ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT = 17,
+  ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT = 20,
+} esp_gap_ble_cb_event_t;
+
+typedef struct {
+  esp_bd_addr_t bd_addr;
+  bool key_present;
+  uint8_t key_type;
+  bool success;
+  uint8_t fail_reason;
+  esp_ble_addr_type_t addr_type;
+} esp_ble_auth_cmpl_t;
+
+typedef union {
+  esp_ble_auth_cmpl_t auth_cmpl;
+} esp_ble_sec_t;
+
+typedef union {
+  struct {
+    esp_bt_status_t status;
+  } adv_start_cmpl;
+  struct {
+    esp_bt_status_t status;
+  } adv_stop_cmpl;
+  esp_ble_sec_t ble_security;
+  struct {
+    int status;
+    esp_bd_addr_t bda;
+    uint16_t min_int;
+    uint16_t max_int;
+    uint16_t latency;
+    uint16_t conn_int;
+    uint16_t timeout;
+  } update_conn_params;
+} esp_ble_gap_cb_param_t;
+
+esp_err_t esp_ble_gap_start_advertising(esp_ble_adv_params_t *params);
+esp_err_t esp_ble_gap_stop_advertising();
@@ -0,0 +1,7 @@
+// Host build: a fixed factory MAC address
+#pragma once
+
+#include <esp_gap_ble_api.h>
+
+esp_err_t esp_efuse_mac_get_default(uint8_t *mac);
+esp_err_t esp_base_mac_addr_set(const uint8_t *mac);
@@ -0,0 +1,405 @@
+#include "synaptics_pad.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "corpus.h"
+
+const uint64_t SIM_PACKET_MS = 12;   // About 80 packets per second, like the real pad
+const uint64_t SIM_TAP_GAP_MS = 80;  // Lift between the two taps of a double tap
+const uint64_t SIM_SETTLE_MS = 600;  // Idle after each gesture, longer than any double click window
+const uint64_t SIM_HOLD_SWIPE_MS = 150;
+const uint64_t SIM_LEAD_IN_MS = 2000;   // No contact while the belt boots and the phone reconnects
+const uint16_t SIM_CENTER_X = 3500;
+const uint16_t SIM_CENTER_Y = 3000;
+
+size_t SynapticsPad::scriptLength() {
+  return SIM_SCRIPT_LENGTH;
+}
+
+// ---- PS/2 device side ----
+
+void SynapticsPad::hostLines(uint64_t us, bool clockLow, bool dataLow) {
+  update(us);
+
+  if (clockLow && !hostClockLow_) {
+    hostClockLowSince_ = us;
+  }
+  if (!clockLow && hostClockLow_) {
+    hostClockReleased_ = us;
+
+    // Request to send: clock inhibited long enough, then released with data low as the start bit.
+    // Like a real PS/2 device, a new command discards any unread output.
+    if (dataLow && (us - hostClockLowSince_ >= INHIBIT_US) && (unpluggedUntil_ == 0)) {
+      output_.clear();
+      state_ = RECEIVING;
+      frameStart_ = us + CLOCK_START_US;
+      receivedBits_ = 0;
+      receivedData_ = 0;
+    }
+  }
+  hostClockLow_ = clockLow;
+  hostDataLow_ = dataLow;
+}
+
+bool SynapticsPad::clockLow(uint64_t us) {
+  update(us);
+  if ((state_ == IDLE) || (us < frameStart_)) {
+    return false;
+  }
+  uint64_t t = us - frameStart_;
+  if (state_ == SENDING) {
+    // Data changes in the first quarter of each bit, the clock is low in the middle half
+    return (t / BIT_US <= 10) && (t % BIT_US >= 20) && (t % BIT_US < 60);
+  }
+  return (t / BIT_US <= 10) && (t % BIT_US < BIT_US / 2);
+}
+
+bool SynapticsPad::dataLow(uint64_t us) {
+  update(us);
+  if ((state_ == IDLE) || (us < frameStart_)) {
+    return false;
+  }
+  uint64_t t = us - frameStart_;
+  if (state_ == SENDING) {
+    return (t / BIT_US <= 10) && !((frameBits_ >> (t / BIT_US)) & 0x01);
+  }
+  // Acknowledge: data low from after the stop bit until the eleventh clock is over
+  return (t >= 9 * BIT_US + 50) && (t < 10 * BIT_US + 50);
+}
+
+// Function to advance the pad to the host's time us (the host lines are unchanged since the last call)
+void SynapticsPad::update(uint64_t us) {
+  // A replugged pad powers up and announces its self test
+  if ((unpluggedUntil_ != 0) && (us >= unpluggedUntil_)) {
+    resetUs_ = unpluggedUntil_;
+    output_.push_back({ 0xAA, unpluggedUntil_ });
+    output_.push_back({ 0x00, unpluggedUntil_ });
+    unpluggedUntil_ = 0;
+  }
+
+  while (streaming_ && (nextPacketUs_ <= us)) {
+    uint64_t tick = nextPacketUs_;
+    nextPacketUs_ += SIM_PACKET_MS * 1000;
+    nextPacket(tick);
+  }
+
+  for (;;) {
+    if (state_ == SENDING) {
+      if (us >= frameStart_ + 10 * BIT_US + 60) {
+        // Stop bit clocked out
+        output_.pop_front();
+        lastFrameEnd_ = frameStart_ + 11 * BIT_US;
+        state_ = IDLE;
+        continue;
+      }
+      if (hostClockLow_) {
+        state_ = IDLE;  // Inhibited: the byte is sent again once the host releases the clock
+      }
+      return;
+    }
+
+    if (state_ == RECEIVING) {
+      if (hostClockLow_) {
+        state_ = IDLE;  // The host gave up on the command
+        return;
+      }
+      // Data bits, parity and stop are read on the rising clock edges
+      while ((receivedBits_ < 10) && (frameStart_ + receivedBits_ * BIT_US + BIT_US / 2 <= us)) {
+        if (!hostDataLow_) {
+          receivedData_ |= 1 << receivedBits_;
+        }
+        receivedBits_++;
+      }
+      if (us >= frameStart_ + 10 * BIT_US + 50) {
+        state_ = IDLE;
+        finishReceive(frameStart_ + 10 * BIT_US + 50);
+        continue;
+      }
+      return;
+    }
+
+    // Idle: send the next byte once the host releases both lines
+    if (output_.empty() || hostClockLow_ || hostDataLow_ || (unpluggedUntil_ != 0)) {
+      return;
+    }
+    frameStart_ = std::max({ hostClockReleased_ + CLOCK_START_US, output_.front().readyUs, lastFrameEnd_ + CLOCK_START_US });
+    uint8_t data = output_.front().data;
+    uint8_t parity = 1;
+    for (uint8_t i = 0; i < 8; i++) {
+      parity ^= (data >> i) & 0x01;
+    }
+    frameBits_ = (1 << 10) | (parity << 9) | (data << 1);
+    state_ = SENDING;
+  }
+}
+
+// Function to check a received frame (odd parity, stop bit) and act on its byte
+void SynapticsPad::finishReceive(uint64_t us) {
+  uint8_t data = receivedData_ & 0xFF;
+  uint8_t ones = 0;
+  for (uint8_t i = 0; i < 9; i++) {
+    ones += (receivedData_ >> i) & 0x01;
+  }
+  bool stopBit = (receivedData_ >> 9) & 0x01;
+  if (!(ones & 0x01) || !stopBit) {
+    respond(0xFE, us);  // Resend
+    return;
+  }
+  handleByte(data, us);
+}
+
+void SynapticsPad::respond(uint8_t data, uint64_t us) {
+  output_.push_back({ data, us + RESPONSE_US });
+}
+
+// Function to handle a byte sent to the pad
+void SynapticsPad::handleByte(uint8_t data, uint64_t us) {
+  if (pendingCommand_ == 0xE8) {
+    pendingCommand_ = 0;
+    sliced_ = (sliced_ << 2) | (data & 0x03);
+    respond(0xFA, us);
+    return;
+  }
+  if (pendingCommand_ == 0xF3) {
+    pendingCommand_ = 0;
+    if (data == 0x14) {
+      mode_ = sliced_;  // Sample rate 20 after a sliced command sets the mode byte
+    } else if ((data == 0xC8) && (sliced_ == 0x03)) {
+      advancedGestures_ = true;  // Sample rate 200 after a sliced 0x03 enables advanced gesture mode
+    }
+    respond(0xFA, us);
+    return;
+  }
+
+  respond(0xFA, us);
+  switch (data) {
+    case 0xE8:
+    case 0xF3:
+      pendingCommand_ = data;
+      break;
+    case 0xE9:  // Status: reporting enabled in bit 5 of the first byte, Wmode in bit 0 of the second
+      respond(streaming_ ? 0x20 : 0x00, us);
+      respond(mode_ & 0x01, us);
+      respond(0x00, us);
+      break;
+    case 0xF2:  // Identify: the TW41xx230 model ID expected by queryModelID()
+      respond(0x00, us);
+      respond(0x09, us);
+      respond(0x00, us);
+      break;
+    case 0xF4:
+      streaming_ = true;
+      nextPacketUs_ = us;
+      gestureStart_ = us;
+      if (awaitingRecovery_ && (mode_ & 0x80)) {
+        // Back in absolute mode and reporting after an injected reset
+        awaitingRecovery_ = false;
+        recovered_++;
+        recoveryMaxUs_ = std::max(recoveryMaxUs_, us - resetUs_);
+      }
+      break;
+    case 0xF5:
+      streaming_ = false;
+      break;
+    case 0xFF:  // Reset: self test passed, back to relative mode
+      powerOn(us);
+      output_.push_back({ 0xAA, us + SELF_TEST_US });
+      output_.push_back({ 0x00, us + SELF_TEST_US });
+      break;
+  }
+}
+
+// Function to put the pad in its power-on state (relative mode, reporting disabled)
+void SynapticsPad::powerOn(uint64_t us) {
+  mode_ = 0;
+  advancedGestures_ = false;
+  sliced_ = 0;
+  pendingCommand_ = 0;
+  streaming_ = false;
+}
+
+// ---- Script playback ----
+
+// Small LCG so every run replays the same jitter
+int16_t SynapticsPad::noise(uint8_t amplitude) {
+  if (amplitude == 0) {
+    return 0;
+  }
+  randomState_ = randomState_ * 1103515245UL + 12345UL;
+  return (int16_t)((randomState_ >> 16) % (2 * amplitude + 1)) - amplitude;
+}
+
+// Function to queue one absolute mode packet, dropped if the host left the pad's buffer full
+void SynapticsPad::queuePacket(uint8_t fingers, uint16_t x, uint16_t y, uint64_t us) {
+  if (output_.size() + 6 > OUTPUT_BUFFER) {
+    droppedPackets_++;
+    return;
+  }
+
+  uint8_t z = (fingers > 0) ? 60 : 0;
+  uint8_t w = 0;  // Idle packets report W=0
+  if (fingers == SIM_PALM) {
+    z = 200;
+    w = 15;
+  } else if (fingers == 1) {
+    w = 4;
+  } else if (fingers == 2) {
+    w = 0;
+  } else if (fingers >= 3) {
+    w = 1;
+  }
+
+  output_.push_back({ (uint8_t)(0x80 | (((w >> 2) & 0x03) << 4) | (((w >> 1) & 0x01) << 2)), us });
+  output_.push_back({ (uint8_t)((((y >> 8) & 0x0F) << 4) | ((x >> 8) & 0x0F)), us });
+  output_.push_back({ z, us });
+  output_.push_back({ (uint8_t)(0xC0 | (((y >> 12) & 0x01) << 5) | (((x >> 12) & 0x01) << 4) | ((w & 0x01) << 2)), us });
+  output_.push_back({ (uint8_t)(x & 0xFF), us });
+  output_.push_back({ (uint8_t)(y & 0xFF), us });
+}
+
+// Function to queue an advanced gesture mode packet (W=2) carrying the finger count
+void SynapticsPad::queueAgmPacket(uint8_t fingers, uint16_t x, uint64_t us) {
+  if (output_.size() + 6 > OUTPUT_BUFFER) {
+    droppedPackets_++;
+    return;
+  }
+
+  output_.push_back({ 0x84, us });  // W=2: bit 1 of W in byte 1, bits 3-2 and 0 clear
+  output_.push_back({ fingers, us });
+  output_.push_back({ 60, us });
+  output_.push_back({ 0xC0, us });
+  output_.push_back({ (uint8_t)(x & 0xFF), us });
+  output_.push_back({ 0x20, us });  // Packet type 2: finger count in byte 2
+}
+
+// Function to find the contact of a script gesture at time t (ms since gesture start)
+bool SynapticsPad::sample(uint8_t index, uint64_t t, uint16_t &x, uint16_t &y) {
+  const SimGesture &g = simScript[index];
+  float p;
+  if ((g.shape == SIM_SWIPE_HOLD) && (t < g.durationMs)) {
+    p = std::min(1.0f, (float)t / SIM_HOLD_SWIPE_MS);
+  } else if (t < g.durationMs) {
+    p = (float)t / g.durationMs;
+  } else if ((g.shape == SIM_DOUBLE_TAP) && (t >= g.durationMs + SIM_TAP_GAP_MS) && (t < 2 * g.durationMs + SIM_TAP_GAP_MS)) {
+    p = 0.0f;
+  } else {
+    return false;
+  }
+
+  float fx = SIM_CENTER_X;
+  float fy = SIM_CENTER_Y;
+  if ((g.shape == SIM_TAP) || (g.shape == SIM_DOUBLE_TAP)) {
+    fx += g.dx;
+    fy += g.dy;
+  } else if ((g.shape == SIM_SWIPE) || (g.shape == SIM_SWIPE_HOLD)) {
+    fx += g.dx * (p - 0.5f);
+    fy += g.dy * (p - 0.5f);
+  } else if (g.shape == SIM_CIRCLE) {
+    // A bit more than one turn; clockwise is a decreasing angle in pad coordinates
+    float angle = ((g.dy > 0) ? -1.0f : 1.0f) * p * 2.2f * (float)M_PI;
+    fx += g.dx * cosf(angle);
+    fy += g.dx * sinf(angle);
+  } else if (g.shape == SIM_SCRUB) {
+    // Z: right, back left while moving down, right again
+    if (p < 1.0f / 3.0f) {
+      fx -= g.dx / 2;
+      fy += g.dy * (3.0f * p - 0.5f);
+    } else if (p < 2.0f / 3.0f) {
+      fx += g.dx * (3.0f * p - 1.5f);
+      fy += g.dy * (1.5f - 3.0f * p);
+    } else {
+      fx += g.dx / 2;
+      fy += g.dy * (3.0f * p - 2.5f);
+    }
+  }
+  x = (uint16_t)(fx + noise(g.jitter));
+  y = (uint16_t)(fy + noise(g.jitter));
+  return true;
+}
+
+// Function to generate the packet of the gesture script due at us
+void SynapticsPad::nextPacket(uint64_t us) {
+  if (gestureIndex_ >= SIM_SCRIPT_LENGTH) {
+    queuePacket(0, 0, 0, us);  // Script done, the pad stays idle
+    return;
+  }
+
+  const SimGesture &g = simScript[gestureIndex_];
+  if ((g.shape == SIM_PAD_RESET) && !resetDone_) {
+    resetDone_ = true;
+    resets_++;
+    awaitingRecovery_ = true;
+    powerOn(us);
+    output_.clear();
+    state_ = IDLE;
+    resetUs_ = us;
+    if (g.durationMs > 0) {
+      unpluggedUntil_ = us + g.durationMs * 1000;
+    } else if (g.dx == SIM_RESET_ANNOUNCED) {
+      output_.push_back({ 0xAA, us });
+      output_.push_back({ 0x00, us });
+    } else if (g.dx == SIM_RESET_RELATIVE) {
+      streaming_ = true;  // Reporting left on in relative mode, e.g. by a stray enable
+    }
+    return;
+  }
+
+  // A pad in relative mode streams 3-byte packets (no buttons, no movement)
+  if (!(mode_ & 0x80)) {
+    if (output_.size() + 3 > OUTPUT_BUFFER) {
+      droppedPackets_++;
+      return;
+    }
+    output_.push_back({ 0x08, us });
+    output_.push_back({ 0x00, us });
+    output_.push_back({ 0x00, us });
+    return;
+  }
+
+  if ((gestureIndex_ == 0) && (us < SIM_LEAD_IN_MS * 1000)) {
+    gestureStart_ = us;
+    queuePacket(0, 0, 0, us);
+    return;
+  }
+
+  uint64_t contactEnd = (g.shape == SIM_DOUBLE_TAP) ? (2 * g.durationMs + SIM_TAP_GAP_MS) : g.durationMs;
+  if (us - gestureStart_ >= (contactEnd + SIM_SETTLE_MS) * 1000) {
+    finishGesture(us);
+    gestureStart_ = us;
+    if (gestureIndex_ >= SIM_SCRIPT_LENGTH) {
+      queuePacket(0, 0, 0, us);
+      return;
+    }
+  }
+
+  uint16_t x = 0, y = 0;
+  if (sample(gestureIndex_, (us - gestureStart_) / 1000, x, y)) {
+    if (firstContact_ == 0) {
+      firstContact_ = us;
+    }
+
+    // In advanced gesture mode a three or four finger contact starts with, and is interleaved
+    // with, W=2 packets; the host only tells four fingers from three through them
+    uint8_t fingers = simScript[gestureIndex_].fingers;
+    bool multiFinger = (fingers == 3) || (fingers == 4);
+    if (multiFinger && advancedGestures_ && ((multiFingerPackets_++ % AGM_PACKET_EVERY) == 0)) {
+      queueAgmPacket(fingers, x, us);
+    } else {
+      queuePacket(fingers, x, y, us);
+    }
+  } else {
+    multiFingerPackets_ = 0;
+    queuePacket(0, 0, 0, us);
+  }
+}
+
+// Function to close the window of the finished gesture and move on to the next one
+void SynapticsPad::finishGesture(uint64_t us) {
+  windows_.push_back({ windowStart_, us, firstContact_ });
+  windowStart_ = us;
+  firstContact_ = 0;
+  resetDone_ = false;
+  gestureIndex_++;
+}
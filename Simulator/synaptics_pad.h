@@ -0,0 +1,113 @@
+// Scripted Synaptics touchpad on the MKR's PS/2 lines. It speaks the PS/2 device protocol bit
+// by bit (the sketch's own bit-banged host code drives it), answers the setup commands and
+// streams absolute packets for the gesture corpus, including pad resets and unplugging.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <vector>
+
+class SynapticsPad {
+ public:
+  // One corpus entry as played: commands and reports in [startUs, endUs) belong to it
+  struct Window {
+    uint64_t startUs;
+    uint64_t endUs;
+    uint64_t firstContactUs;  // First contact packet, 0 if the entry has no contact
+  };
+
+  // Host side of the lines, called whenever the sketch changes them
+  void hostLines(uint64_t us, bool clockLow, bool dataLow);
+
+  // Device side: true while the pad pulls the line low
+  bool clockLow(uint64_t us);
+  bool dataLow(uint64_t us);
+
+  bool scriptDone() const { return windows_.size() == scriptLength(); }
+  const std::vector<Window> &windows() const { return windows_; }
+  uint16_t resets() const { return resets_; }
+  uint16_t recovered() const { return recovered_; }
+  uint64_t recoveryMaxUs() const { return recoveryMaxUs_; }
+  uint32_t droppedPackets() const { return droppedPackets_; }
+
+ private:
+  // PS/2 timing: 80 us clock period, the clock is low for 40 us of it
+  static const uint64_t BIT_US = 80;
+  static const uint64_t INHIBIT_US = 100;        // Clock held this long before a request to send
+  static const uint64_t CLOCK_START_US = 50;     // Delay before the pad starts clocking
+  static const uint64_t RESPONSE_US = 250;       // Command processing time
+  static const uint64_t SELF_TEST_US = 300000;   // Reset to 0xAA 0x00
+  static const size_t OUTPUT_BUFFER = 24;        // Bytes the pad holds while the host inhibits it
+  static const uint8_t AGM_PACKET_EVERY = 4;     // Multi-finger contacts send a W=2 packet this often
+
+  enum State {
+    IDLE,
+    SENDING,
+    RECEIVING
+  };
+
+  struct OutputByte {
+    uint8_t data;
+    uint64_t readyUs;
+  };
+
+  static size_t scriptLength();
+
+  void update(uint64_t us);
+  void finishReceive(uint64_t us);
+  void handleByte(uint8_t data, uint64_t us);
+  void respond(uint8_t data, uint64_t us);
+  void powerOn(uint64_t us);
+
+  // Script playback
+  void nextPacket(uint64_t us);
+  void queuePacket(uint8_t fingers, uint16_t x, uint16_t y, uint64_t us);
+  void queueAgmPacket(uint8_t fingers, uint16_t x, uint64_t us);
+  bool sample(uint8_t index, uint64_t t, uint16_t &x, uint16_t &y);
+  void finishGesture(uint64_t us);
+  int16_t noise(uint8_t amplitude);
+
+  // Lines as driven by the host
+  bool hostClockLow_ = false;
+  bool hostDataLow_ = false;
+  uint64_t hostClockLowSince_ = 0;
+  uint64_t hostClockReleased_ = 0;
+
+  // Link state
+  State state_ = IDLE;
+  uint64_t frameStart_ = 0;
+  uint16_t frameBits_ = 0;  // Start, 8 data, parity and stop bits, LSB first
+  uint64_t lastFrameEnd_ = 0;
+  uint8_t receivedBits_ = 0;
+  uint16_t receivedData_ = 0;
+  std::deque<OutputByte> output_;
+  uint32_t droppedPackets_ = 0;
+
+  // Device state
+  uint8_t pendingCommand_ = 0;  // E8 or F3 waiting for its argument byte
+  uint8_t sliced_ = 0;          // Last four E8 arguments, two bits each
+  uint8_t mode_ = 0;
+  bool advancedGestures_ = false;  // Sliced 0x03 then sample rate 0xC8 (EWmode)
+  bool streaming_ = false;
+  uint64_t nextPacketUs_ = 0;
+  uint64_t unpluggedUntil_ = 0;
+
+  // Pad reset injection and recovery scoring
+  bool resetDone_ = false;  // The current SIM_PAD_RESET entry already reset the pad
+  uint64_t resetUs_ = 0;    // When the reset pad became reachable again
+  bool awaitingRecovery_ = false;
+  uint16_t resets_ = 0;
+  uint16_t recovered_ = 0;
+  uint64_t recoveryMaxUs_ = 0;
+
+  // Script playback
+  uint8_t gestureIndex_ = 0;
+  uint64_t gestureStart_ = 0;
+  uint64_t windowStart_ = 0;
+  uint64_t firstContact_ = 0;
+  uint16_t multiFingerPackets_ = 0;  // Packets of the current three or four finger contact
+  uint32_t randomState_ = 1;
+  std::vector<Window> windows_;
+};
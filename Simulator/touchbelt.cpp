@@ -0,0 +1,88 @@
+#include "touchbelt.h"
+
+const uint8_t MKR_PS2_CLOCK = 4;
+const uint8_t MKR_PS2_DATA = 5;
+const uint8_t CMD_BITS = 6;
+const uint8_t MKR_CMD_PINS[CMD_BITS] = { 0, 1, 2, 3, 7, 8 };
+const uint8_t ESP32_CMD_PINS[CMD_BITS] = { 23, 22, 21, 19, 18, 17 };
+
+const unsigned int MKR_PIN_ACCESS_US = 1;  // SAMD21 digitalRead/digitalWrite take about a microsecond
+const unsigned int ESP32_PIN_ACCESS_US = 0;
+
+static int commandBit(const uint8_t *pins, uint8_t pin) {
+  for (uint8_t bit = 0; bit < CMD_BITS; bit++) {
+    if (pins[bit] == pin) {
+      return bit;
+    }
+  }
+  return -1;
+}
+
+MkrBoard::MkrBoard(SynapticsPad &pad, CommandBus &bus, UartLink &link)
+    : Board("mkr", MKR_PIN_ACCESS_US), pad_(pad), bus_(bus), link_(link) {}
+
+void MkrBoard::pinMode(uint8_t pin, uint8_t mode) {
+  Board::pinMode(pin, mode);
+  padLinesChanged(pin);
+}
+
+void MkrBoard::digitalWrite(uint8_t pin, uint8_t value) {
+  Board::digitalWrite(pin, value);
+  padLinesChanged(pin);
+
+  int bit = commandBit(MKR_CMD_PINS, pin);
+  if ((bit >= 0) && (pinModes_[pin] == OUTPUT)) {
+    bus_.drive(now(), bit, value);
+  }
+}
+
+// The PS/2 lines are open collector: low while either side pulls them low
+int MkrBoard::digitalRead(uint8_t pin) {
+  if (pin == MKR_PS2_CLOCK) {
+    advance(pinAccessUs_);
+    return (drivesLow(pin) || pad_.clockLow(now())) ? LOW : HIGH;
+  }
+  if (pin == MKR_PS2_DATA) {
+    advance(pinAccessUs_);
+    return (drivesLow(pin) || pad_.dataLow(now())) ? LOW : HIGH;
+  }
+  return Board::digitalRead(pin);
+}
+
+int MkrBoard::serialAvailableForWrite(uint8_t port) {
+  return (port == 1) ? link_.txFree(now()) : 0;
+}
+
+void MkrBoard::serialWrite(uint8_t port, uint8_t data) {
+  if (port == 1) {
+    link_.send(now(), data);
+    return;
+  }
+  Board::serialWrite(port, data);
+}
+
+void MkrBoard::padLinesChanged(uint8_t pin) {
+  if ((pin == MKR_PS2_CLOCK) || (pin == MKR_PS2_DATA)) {
+    pad_.hostLines(now(), drivesLow(MKR_PS2_CLOCK), drivesLow(MKR_PS2_DATA));
+  }
+}
+
+Esp32Board::Esp32Board(CommandBus &bus, UartLink &link)
+    : Board("esp32", ESP32_PIN_ACCESS_US), bus_(bus), link_(link) {}
+
+int Esp32Board::digitalRead(uint8_t pin) {
+  int bit = commandBit(ESP32_CMD_PINS, pin);
+  if (bit >= 0) {
+    advance(pinAccessUs_);
+    return bus_.read(now(), bit) ? HIGH : LOW;
+  }
+  return Board::digitalRead(pin);
+}
+
+int Esp32Board::serialAvailable(uint8_t port) {
+  return (port == 2) ? link_.available(now()) : 0;
+}
+
+int Esp32Board::serialRead(uint8_t port) {
+  return (port == 2) ? link_.read(now()) : -1;
+}
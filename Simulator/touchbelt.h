@@ -0,0 +1,59 @@
+// The two TouchBelt boards as wired on the belt: the pad on the MKR's PS/2 pins, the command bus
+// and the stream UART from the MKR to the ESP32
+#pragma once
+
+#include "board.h"
+#include "links.h"
+#include "synaptics_pad.h"
+
+// The unmodified sketches, each compiled into its own namespace (see ArduinoSketch.cmake)
+namespace mkr_sketch {
+void setup();
+void loop();
+}
+
+namespace esp32_sketch {
+void setup();
+void loop();
+}
+
+// Arduino MKR: PS/2 clock on 4, data on 5, command bus on 0, 1, 2, 3, 7, 8, stream on Serial1
+class MkrBoard : public Board {
+ public:
+  MkrBoard(SynapticsPad &pad, CommandBus &bus, UartLink &link);
+
+  void pinMode(uint8_t pin, uint8_t mode) override;
+  void digitalWrite(uint8_t pin, uint8_t value) override;
+  int digitalRead(uint8_t pin) override;
+  int serialAvailableForWrite(uint8_t port) override;
+  void serialWrite(uint8_t port, uint8_t data) override;
+
+ protected:
+  void sketchSetup() override { mkr_sketch::setup(); }
+  void sketchLoop() override { mkr_sketch::loop(); }
+
+ private:
+  void padLinesChanged(uint8_t pin);
+
+  SynapticsPad &pad_;
+  CommandBus &bus_;
+  UartLink &link_;
+};
+
+// ESP32: command bus on 23, 22, 21, 19, 18, 17, stream on Serial2, buttons not pressed
+class Esp32Board : public Board {
+ public:
+  Esp32Board(CommandBus &bus, UartLink &link);
+
+  int digitalRead(uint8_t pin) override;
+  int serialAvailable(uint8_t port) override;
+  int serialRead(uint8_t port) override;
+
+ protected:
+  void sketchSetup() override { esp32_sketch::setup(); }
+  void sketchLoop() override { esp32_sketch::loop(); }
+
+ private:
+  CommandBus &bus_;
+  UartLink &link_;
+};